@@ -0,0 +1,271 @@
+#include "autotune.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <cstdlib>
+#include <stdexcept>
+#include <tuple>
+
+#include "bench.h"
+#include "cuckoo/mean_solver.h"
+
+namespace cuckoo_sip {
+
+static bool read_line(const std::string& path, std::string& out) {
+    std::ifstream in(path);
+    return static_cast<bool>(std::getline(in, out));
+}
+
+// "48K" / "2048K" / "30M" as found in sysfs cache size files
+static size_t parse_size(const std::string& s) {
+    size_t v = 0, i = 0;
+    while (i < s.size() && s[i] >= '0' && s[i] <= '9') v = v * 10 + static_cast<size_t>(s[i++] - '0');
+    if (i < s.size()) {
+        if (s[i] == 'K') v <<= 10;
+        else if (s[i] == 'M') v <<= 20;
+        else if (s[i] == 'G') v <<= 30;
+    }
+    return v;
+}
+
+static uint32_t log2_floor(size_t v) {
+    uint32_t r = 0;
+    while (v > 1) { v >>= 1; ++r; }
+    return r;
+}
+
+size_t MachineTopology::data_cache_bytes(uint32_t level) const {
+    for (const auto& c : caches)
+        if (c.level == level && c.type != "Instruction") return c.bytes;
+    return 0;
+}
+
+MachineTopology read_topology() {
+    MachineTopology t;
+    for (int idx = 0; idx < 16; ++idx) {
+        const std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(idx) + "/";
+        std::string level, type, size;
+        if (!read_line(dir + "level", level) || !read_line(dir + "type", type) || !read_line(dir + "size", size)) break;
+        CacheLevel c;
+        c.level = static_cast<uint32_t>(std::strtoul(level.c_str(), nullptr, 10));
+        c.type = type;
+        c.bytes = parse_size(size);
+        t.caches.push_back(c);
+    }
+    t.cpus = std::max(1U, std::thread::hardware_concurrency());
+
+    std::ifstream mem("/proc/meminfo");
+    std::string key, unit;
+    size_t kb = 0;
+    while (mem >> key >> kb) {
+        std::getline(mem, unit);
+        if (key == "MemTotal:") { t.mem_bytes = kb << 10; break; }
+    }
+    return t;
+}
+
+std::string default_profile_path() {
+    if (const char* env = std::getenv("CUCKOO_SIP_PROFILE")) return env;
+    if (const char* home = std::getenv("HOME")) return std::string(home) + "/.cuckoo_sip_profile";
+    return ".cuckoo_sip_profile";
+}
+
+std::vector<TunedConfig> load_profile(const std::string& path) {
+    std::vector<TunedConfig> out;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        std::istringstream iss(line);
+        TunedConfig e;
+        std::string field;
+        while (iss >> field) {
+            const size_t eq = field.find('=');
+            if (eq == std::string::npos) continue;
+            const std::string k = field.substr(0, eq), v = field.substr(eq + 1);
+            try {
+                if (k == "edge_bits") e.edge_bits = static_cast<uint32_t>(std::stoul(v));
+                else if (k == "mode") e.mode = v;
+                else if (k == "cycle_length") e.cycle_length = static_cast<uint32_t>(std::stoul(v));
+                else if (k == "hash") {
+                    if (v == "sip12") e.variant = SipHashVariant::SipHash12;
+                    else if (v == "sip24") e.variant = SipHashVariant::SipHash24;
+                    else throw std::invalid_argument(v);
+                }
+                else if (k == "graph") {
+                    if (v == "sip") e.family = GraphFamily::PerEdge;
+                    else if (v == "block64") e.family = GraphFamily::Block64;
+                    else throw std::invalid_argument(v);
+                }
+                else if (k == "bucket_bits") e.bucket_bits = static_cast<uint32_t>(std::stoul(v));
+                else if (k == "threads") e.threads = static_cast<uint32_t>(std::stoul(v));
+                else if (k == "memcap_bpe") e.memcap_bpe = std::stod(v);
+                else if (k == "graph_s") e.graph_s = std::stod(v);
+            } catch (const std::exception&) {
+                e.mode.clear();
+                break;
+            }
+        }
+        if (e.edge_bits && (e.mode == "lean" || e.mode == "mean") && e.threads) out.push_back(e);
+    }
+    return out;
+}
+
+bool save_profile(const std::string& path, const std::vector<TunedConfig>& entries, const MachineTopology& topo) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "# cuckoo_sip autotune profile: cpus=" << topo.cpus;
+    for (const auto& c : topo.caches)
+        if (c.type != "Instruction") out << " L" << c.level << "=" << (c.bytes >> 10) << "K";
+    out << " mem=" << (topo.mem_bytes >> 20) << "M\n";
+    for (const auto& e : entries) {
+        out << "edge_bits=" << e.edge_bits << " mode=" << e.mode << " cycle_length=" << e.cycle_length
+            << " hash=" << (e.variant == SipHashVariant::SipHash12 ? "sip12" : "sip24")
+            << " graph=" << graph_family_name(e.family) << " bucket_bits=" << e.bucket_bits
+            << " threads=" << e.threads << " memcap_bpe=" << e.memcap_bpe
+            << std::fixed << std::setprecision(6) << " graph_s=" << e.graph_s << "\n";
+        out.unsetf(std::ios::floatfield);
+    }
+    return static_cast<bool>(out);
+}
+
+static bool same_workload(const TunedConfig& a, const TunedConfig& b) {
+    return a.edge_bits == b.edge_bits && a.cycle_length == b.cycle_length && a.variant == b.variant && a.family == b.family;
+}
+
+const TunedConfig* find_profile_entry(const std::vector<TunedConfig>& entries, const TunedConfig& key, const std::string& mode) {
+    const TunedConfig* best = nullptr;
+    for (const auto& e : entries) {
+        if (!same_workload(e, key) || (!mode.empty() && e.mode != mode)) continue;
+        if (!best || e.graph_s < best->graph_s) best = &e;
+    }
+    return best;
+}
+
+// Bucket radixes whose per-bucket degree bitmaps (2 bits per residual node) fit in L1 and in L2,
+// the largest whose scatter cursors fill at most half of L1, plus the solver default. Falls back
+// to the default alone when the caches are unknown.
+static std::vector<uint32_t> bucket_candidates(const MachineTopology& topo, uint32_t edge_bits) {
+    std::vector<uint32_t> out{ std::min<uint32_t>(12, edge_bits) };
+    for (uint32_t level : { 1U, 2U }) {
+        const size_t bytes = topo.data_cache_bytes(level);
+        if (!bytes) continue;
+        // seen + nonleaf = 2 * 2^residual bits = 2^(residual - 2) bytes
+        const uint32_t residual = log2_floor(bytes) + 2;
+        const uint32_t bb = edge_bits > residual ? edge_bits - residual : 1;
+        out.push_back(std::min(bb, edge_bits));
+    }
+    if (const size_t l1 = topo.data_cache_bytes(1)) {
+        // B cursors of 8 bytes in L1/2
+        const uint32_t bb = log2_floor(l1) > 4 ? log2_floor(l1) - 4 : 1;
+        out.push_back(std::min(bb, edge_bits));
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+static std::vector<uint32_t> thread_candidates(const MachineTopology& topo) {
+    std::vector<uint32_t> out;
+    for (uint32_t t = 1; t <= topo.cpus; t <<= 1) out.push_back(t);
+    if (out.back() != topo.cpus) out.push_back(topo.cpus);
+    return out;
+}
+
+int run_autotune(const AutotuneConfig& cfg) {
+    const MachineTopology topo = read_topology();
+    std::cout << "Autotune: cpus=" << topo.cpus;
+    for (const auto& c : topo.caches) std::cout << " L" << c.level << c.type[0] << "=" << (c.bytes >> 10) << "K";
+    std::cout << " mem=" << (topo.mem_bytes >> 20) << "M\n";
+
+    std::vector<TunedConfig> profile = load_profile(cfg.profile_path);
+    const auto threads = thread_candidates(topo);
+
+    for (uint32_t eb : cfg.edge_bits) {
+        BenchConfig base;
+        base.edge_bits = eb;
+        base.attempts = cfg.probe_attempts;
+        base.cycle_length = cfg.cycle_length;
+        base.variant = cfg.variant;
+        base.family = cfg.family;
+        base.seeded = true;
+        base.seed = cfg.seed;
+        base.quiet = true;
+
+        TunedConfig workload;
+        workload.edge_bits = eb;
+        workload.cycle_length = cfg.cycle_length;
+        workload.variant = cfg.variant;
+        workload.family = cfg.family;
+        std::vector<TunedConfig> candidates;
+        for (uint32_t t : threads) {
+            TunedConfig lean = workload;
+            lean.mode = "lean";
+            lean.threads = t;
+            candidates.push_back(lean);
+            for (uint32_t bb : bucket_candidates(topo, eb)) {
+                TunedConfig mean = workload;
+                mean.mode = "mean";
+                mean.bucket_bits = bb;
+                mean.threads = t;
+                // Keep the unbounded layout only if it leaves half of RAM free; otherwise cap it.
+                Params p;
+                set_edge_bits(p, eb);
+                const double n = static_cast<double>(p.N);
+                if (topo.mem_bytes && MeanSolver(p, t, bb).memory_usage_bytes() > topo.mem_bytes / 2)
+                    mean.memcap_bpe = static_cast<double>(topo.mem_bytes / 2) / n;
+                candidates.push_back(mean);
+            }
+        }
+
+        TunedConfig best_of[2];
+        for (auto& c : candidates) {
+            BenchConfig bc = base;
+            bc.mode = c.mode;
+            bc.threads = c.threads;
+            bc.bucket_bits = c.mode == "mean" ? c.bucket_bits : base.bucket_bits;
+            bc.memcap_bpe = c.memcap_bpe;
+            const BenchStats st = run_bench(bc);
+            c.graph_s = st.p50_time_s;
+            std::cout << std::fixed << std::setprecision(6)
+                      << "  probe edge_bits=" << eb << " mode=" << c.mode << " bucket_bits=" << c.bucket_bits
+                      << " threads=" << c.threads << " memcap_bpe=" << c.memcap_bpe << ": p50 " << c.graph_s << " s\n";
+            std::cout.unsetf(std::ios::floatfield);
+            // A candidate that threw on any probe graph has no usable time
+            if (st.errors) {
+                std::cout << "    skipped: " << st.errors << "/" << st.attempts << " probe attempts threw\n";
+                continue;
+            }
+            TunedConfig& best = best_of[c.mode == "mean"];
+            if (best.edge_bits == 0 || c.graph_s < best.graph_s) best = c;
+        }
+
+        for (const auto& b : best_of) {
+            if (b.edge_bits == 0) continue;
+            profile.erase(std::remove_if(profile.begin(), profile.end(), [&](const TunedConfig& e) {
+                return same_workload(e, b) && e.mode == b.mode;
+            }), profile.end());
+            profile.push_back(b);
+            std::cout << "  best " << b.mode << ": bucket_bits=" << b.bucket_bits << " threads=" << b.threads
+                      << " memcap_bpe=" << b.memcap_bpe << " (" << b.graph_s << " s/graph)\n";
+        }
+    }
+
+    std::sort(profile.begin(), profile.end(), [](const TunedConfig& a, const TunedConfig& b) {
+        return std::make_tuple(a.edge_bits, a.cycle_length, a.variant, a.family, a.mode) <
+               std::make_tuple(b.edge_bits, b.cycle_length, b.variant, b.family, b.mode);
+    });
+    if (!save_profile(cfg.profile_path, profile, topo)) {
+        std::cerr << "Cannot write profile: " << cfg.profile_path << "\n";
+        return 1;
+    }
+    std::cout << "Profile written to " << cfg.profile_path << "\n";
+    return 0;
+}
+
+} // namespace cuckoo_sip
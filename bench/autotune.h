@@ -0,0 +1,73 @@
+#ifndef CUCKOO_SIP_AUTOTUNE_H
+#define CUCKOO_SIP_AUTOTUNE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "cuckoo/graph.h"
+
+namespace cuckoo_sip {
+
+struct CacheLevel {
+    uint32_t level = 0;
+    std::string type;  // "Data", "Instruction", "Unified"
+    size_t bytes = 0;
+};
+
+// Host description from sysfs (cpu0 caches), /proc/meminfo and hardware_concurrency.
+// Fields stay zero/empty when unreadable.
+struct MachineTopology {
+    std::vector<CacheLevel> caches;
+    uint32_t cpus = 0;
+    size_t mem_bytes = 0;
+
+    size_t data_cache_bytes(uint32_t level) const; // data or unified cache at level, 0 if unknown
+};
+
+MachineTopology read_topology();
+
+// Best configuration found for one (edge_bits, mode) of one graph (cycle length, hash, family);
+// one line per entry in the profile file.
+struct TunedConfig {
+    uint32_t edge_bits = 0;
+    std::string mode;
+    uint32_t cycle_length = 42;
+    SipHashVariant variant = SipHashVariant::SipHash12;
+    GraphFamily family = GraphFamily::PerEdge;
+    uint32_t bucket_bits = 0;
+    uint32_t threads = 1;
+    double memcap_bpe = 0.0; // 0 = solver default
+    double graph_s = 0.0;    // probe p50 time per graph
+};
+
+// $CUCKOO_SIP_PROFILE if set, else $HOME/.cuckoo_sip_profile
+std::string default_profile_path();
+
+// Missing or unreadable file yields an empty list. Entries without cycle_length / hash / graph
+// fields (older profiles) get the defaults: 42, sip12, sip.
+std::vector<TunedConfig> load_profile(const std::string& path);
+bool save_profile(const std::string& path, const std::vector<TunedConfig>& entries, const MachineTopology& topo);
+
+// Entry to apply for edge_bits on graphs like key's (cycle length, hash, family): the given
+// mode's entry, or the fastest one when mode is empty.
+const TunedConfig* find_profile_entry(const std::vector<TunedConfig>& entries, const TunedConfig& key, const std::string& mode);
+
+struct AutotuneConfig {
+    std::vector<uint32_t> edge_bits;
+    uint32_t probe_attempts = 3;  // seeded graphs per candidate
+    uint32_t cycle_length = 42;
+    SipHashVariant variant = SipHashVariant::SipHash12;
+    GraphFamily family = GraphFamily::PerEdge;
+    uint64_t seed = 1;
+    std::string profile_path;
+};
+
+// Probes lean/mean x threads x bucket_bits candidates derived from the topology for every
+// edge_bits, then merges the per-mode winners into the profile. Returns 0 on success.
+int run_autotune(const AutotuneConfig& cfg);
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_AUTOTUNE_H
@@ -4,92 +4,497 @@
 #include <iomanip>
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <tuple>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 #include "util.h"
 #include "cuckoo/lean_solver.h"
 #include "cuckoo/mean_solver.h"
+#include "cuckoo/batch_lean_solver.h"
 #include "verify/verify.h"
 
 namespace cuckoo_sip {
 
 static inline double ns_to_s(uint64_t ns) { return double(ns) * 1e-9; }
 
-BenchStats run_bench(const BenchConfig& cfg) {
-    BenchStats stats;
-    stats.attempts = cfg.attempts;
+// memcap_bpe == 0 selects each solver's default: 1 byte/edge for lean, unbounded for mean.
+static inline double lean_memcap(const BenchConfig& cfg) { return cfg.memcap_bpe > 0.0 ? cfg.memcap_bpe : 1.0; }
 
-    for (uint32_t a = 0; a < cfg.attempts; ++a) {
-        Params p;
-        set_edge_bits(p, cfg.edge_bits);
+std::vector<CorpusEntry> load_header_corpus(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open header corpus: " + path);
+    std::vector<CorpusEntry> out;
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        std::istringstream iss(line);
+        CorpusEntry e;
+        if (!(iss >> e.header)) continue;
+        iss >> e.edge_bits >> e.cycle_length;
+        out.push_back(e);
+    }
+    return out;
+}
+
+// Header sequence for one run_bench call: fixed --header, corpus entries usable at this
+// edge_bits, then seeded or random headers once the corpus is exhausted.
+class HeaderSource {
+public:
+    explicit HeaderSource(const BenchConfig& cfg) : cfg_(cfg), gen_(cfg.seed) {
+        for (const auto& e : cfg.corpus)
+            if (e.edge_bits == 0 || e.edge_bits == cfg.edge_bits) corpus_.push_back(&e);
+    }
 
-        // Key derivation: use fixed header_hex if provided
+    // Sets p.key for the next attempt; returns the header and the corpus entry (if any) used.
+    std::string next(Params& p, const CorpusEntry** entry) {
+        *entry = nullptr;
+        if (!cfg_.header_hex.empty()) {
+            auto parsed = parse_hex_key128(cfg_.header_hex);
+            p.key = parsed ? *parsed : derive_key_from_header(cfg_.header_hex);
+            return cfg_.header_hex;
+        }
         std::string header;
-        if (!cfg.header_hex.empty()) {
-            header = cfg.header_hex;
-            auto parsed = parse_hex_key128(cfg.header_hex);
-            if (parsed) p.key = *parsed; else p.key = derive_key_from_header(header);
+        if (pos_ < corpus_.size()) {
+            *entry = corpus_[pos_++];
+            header = (*entry)->header;
         } else {
-            header = random_hex_header();
-            p.key = derive_key_from_header(header);
+            header = cfg_.seeded ? seeded_hex_header(gen_) : random_hex_header();
         }
-        p.variant = cfg.variant;
+        p.key = derive_key_from_header(header);
+        return header;
+    }
+
+private:
+    const BenchConfig& cfg_;
+    std::mt19937_64 gen_;
+    std::vector<const CorpusEntry*> corpus_;
+    size_t pos_ = 0;
+};
+
+// Nearest-rank percentile of an ascending-sorted sample
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+    if (rank == 0) rank = 1;
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
 
+static void print_perf(const PerfReport& r, const char* indent) {
+    if (!r.available) std::cout << indent << "perf: counters unavailable (" << r.error << "); wall time only\n";
+    for (size_t t = 0; t <= (r.threads.size() > 1 ? r.threads.size() : 0); ++t) {
+        const auto& phases = (t == 0) ? r.phases : r.threads[t - 1];
+        for (size_t i = 0; i < kPhaseCount; ++i) {
+            const PerfSample& s = phases[i];
+            if (s.wall_ns == 0) continue;
+            std::cout << indent << "perf " << phase_name(static_cast<Phase>(i));
+            if (t > 0) std::cout << "[t" << (t - 1) << "]";
+            std::cout << ": wall_s= " << ns_to_s(s.wall_ns);
+            if (r.available) {
+                std::cout << ", cycles= " << s.cycles << ", ipc= " << (s.cycles ? double(s.instructions) / s.cycles : 0.0)
+                          << ", llc_miss= " << s.llc_misses << ", dtlb_miss= " << s.dtlb_misses
+                          << ", br_miss= " << s.branch_misses;
+            }
+            std::cout << "\n";
+        }
+    }
+}
+
+static void print_mem(const MemReport& r, const char* indent) {
+    const double mib = 1.0 / (1024.0 * 1024.0);
+    const auto flags = std::cout.flags();
+    const auto prec = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << indent << "mem tracked peak MiB= " << r.tracked_peak_bytes * mib << " (";
+    for (size_t t = 0; t < kMemTagCount; ++t) {
+        std::cout << (t ? ", " : "") << mem_tag_name(static_cast<MemTag>(t)) << " " << r.tags[t].peak_bytes * mib
+                  << "/" << r.tags[t].allocs << " allocs";
+    }
+    std::cout << ")\n" << indent << "mem rss peak MiB" << (r.phase_rss_exact ? "" : " (process lifetime)")
+              << ": solve= " << r.rss_peak_kb / 1024.0;
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+        if (r.phase_rss_peak_kb[i] == 0) continue;
+        std::cout << ", " << phase_name(static_cast<Phase>(i)) << "= " << r.phase_rss_peak_kb[i] / 1024.0;
+    }
+    std::cout << "\n";
+    if (!r.round_rss_kb.empty()) {
+        std::cout << indent << "mem rss per round MiB:";
+        for (size_t k = 0; k < r.round_rss_kb.size(); ++k) std::cout << (k ? ", " : " ") << r.round_rss_kb[k] / 1024.0;
+        std::cout << "\n";
+    }
+    std::cout.flags(flags);
+    std::cout.precision(prec);
+}
+
+// Verify, print and accumulate one attempt's outcome.
+static void record_attempt(const BenchConfig& cfg, BenchStats& stats, uint32_t a, const Params& p,
+                           const std::string& header, const CorpusEntry* entry,
+                           const std::vector<std::vector<uint64_t>>& solutions, const std::string& note, double dt) {
+    // A throwing attempt has no meaningful time (0 when it failed before the solve): count it apart
+    const bool error = note.rfind("Exception: ", 0) == 0;
+    stats.total_wall_s += dt;
+    if (error) stats.errors++;
+    else stats.times_all_s.push_back(dt);
+    const bool known = entry && entry->edge_bits == cfg.edge_bits && entry->cycle_length == cfg.cycle_length;
+    if (known) stats.known_cycles++;
+
+    // Verify every solution (supports arbitrary k); the graph counts once if any verifies
+    uint32_t verified = 0;
+    for (const auto& solution : solutions) {
+        std::string err;
+        if (!verify_cycle_k(p, solution, cfg.cycle_length, &err)) {
+            std::cerr << "Verification failed: " << err << "\n";
+            continue;
+        }
+        ++verified;
+        if (!cfg.quiet) {
+            std::cout << "Solution edges (" << cfg.cycle_length << "): ";
+            for (size_t k = 0; k < solution.size(); ++k) { if (k) std::cout << ","; std::cout << solution[k]; }
+            std::cout << "\n";
+        }
+    }
+    const bool success = verified > 0;
+    stats.solutions += verified;
+    if (success) {
+        stats.successes++;
+        if (known) stats.known_found++;
+        stats.times_success_s.push_back(dt);
+    }
+
+    if (cfg.quiet) return;
+    std::cout << std::fixed << std::setprecision(6)
+              << "Attempt " << (a + 1) << "/" << cfg.attempts
+              << ", header= " << header
+              << ", success= " << (success ? "yes" : "no")
+              << (verified > 1 ? ", solutions= " + std::to_string(verified) : std::string())
+              << ", time_s= " << dt
+              << (note.empty() ? "" : (std::string(", note= ") + note))
+              << (known ? ", known_cycle= yes" : "")
+              << "\n";
+}
+
+// Lean mode with batch > 1: solve groups of attempts in lockstep; each graph is charged the
+// group's wall time divided by the group size.
+static void run_lean_batched(const BenchConfig& cfg, BenchStats& stats) {
+    HeaderSource source(cfg);
+    for (uint32_t a0 = 0; a0 < cfg.attempts; a0 += cfg.batch) {
+        const uint32_t g_count = std::min(cfg.batch, cfg.attempts - a0);
+        std::vector<Params> ps(g_count);
+        std::vector<std::string> headers(g_count);
+        std::vector<const CorpusEntry*> entries(g_count);
+        std::vector<SipHashKey> keys(g_count);
+        for (uint32_t g = 0; g < g_count; ++g) {
+            set_edge_bits(ps[g], cfg.edge_bits);
+            ps[g].variant = cfg.variant;
+            ps[g].family = cfg.family;
+            headers[g] = source.next(ps[g], &entries[g]);
+            keys[g] = ps[g].key;
+        }
+
+        // Batched solves report tracked bytes and the process peak RSS for the whole group
+        MemReport mem;
+        if (cfg.mem) mem.begin();
         uint64_t t0 = now_ns();
-        bool success = false;
-        std::vector<uint64_t> solution;
-        double mem_bpe = 0.0;
-        std::string note;
+        std::vector<LeanResult> results;
+        std::string error;
+        try {
+            BatchLeanSolver solver(ps[0], keys, cfg.threads, lean_memcap(cfg));
+            results = solver.solve(256, cfg.cycle_length);
+        } catch (const std::exception& e) {
+            error = std::string("Exception: ") + e.what();
+        }
+        uint64_t t1 = now_ns();
+        if (cfg.mem) {
+            mem.end();
+            stats.mem.merge(mem);
+            if (!cfg.quiet) print_mem(mem, "  ");
+        }
+        const double dt = ns_to_s(t1 - t0) / g_count;
+
+        for (uint32_t g = 0; g < g_count; ++g) {
+            if (!error.empty()) {
+                record_attempt(cfg, stats, a0 + g, ps[g], headers[g], entries[g], {}, error, dt);
+                continue;
+            }
+            if (a0 == 0 && g == 0) stats.mem_bpe = results[g].mem_bytes_per_edge;
+            record_attempt(cfg, stats, a0 + g, ps[g], headers[g], entries[g],
+                           results[g].solutions, results[g].note + " [batch x" + std::to_string(g_count) + "]", dt);
+        }
+    }
+}
+
+// Solvers configured from cfg (shared by the serial and pipelined drivers)
+static std::unique_ptr<LeanSolver> make_lean(const BenchConfig& cfg, const Params& p, const EdgeSource& edges) {
+    std::unique_ptr<LeanSolver> solver(new LeanSolver(p, cfg.threads, lean_memcap(cfg)));
+    solver->set_perf(cfg.perf);
+    solver->set_bounded_recovery(cfg.bounded_recovery);
+    solver->set_prefetch(cfg.prefetch);
+    solver->set_fused(cfg.fused);
+    solver->set_edge_source(edges);
+    solver->set_mem_report(cfg.mem);
+    return solver;
+}
+
+static std::unique_ptr<MeanSolver> make_mean(const BenchConfig& cfg, const Params& p, const EdgeSource& edges) {
+    std::unique_ptr<MeanSolver> solver(new MeanSolver(p, cfg.threads, cfg.bucket_bits, cfg.memcap_bpe));
+    solver->set_perf(cfg.perf);
+    solver->set_mem_report(cfg.mem);
+    solver->set_pipeline(cfg.hash_threads, cfg.scatter_threads);
+    solver->set_nt_stores(cfg.nt_stores);
+    solver->set_fine_bucket_bits(cfg.fine_bucket_bits);
+    solver->set_fused(cfg.fused);
+    solver->set_edge_source(edges);
+    return solver;
+}
+
+static EdgeSource make_edge_source(const BenchConfig& cfg, const Params& p) {
+    if (cfg.edges == EdgeSourceKind::Memory) return EdgeSource::in_memory(p);
+    if (cfg.edges == EdgeSourceKind::Mapped) {
+        // A file written for this attempt is unlinked right away unless kept; the solvers' mapping
+        // holds its blocks until they are done, so random headers don't pile up N x 8 bytes each
+        const std::string path = endpoint_file_path(cfg.edge_dir, p);
+        bool written = false;
+        EdgeSource src = EdgeSource::mapped(p, path, &written);
+        if (written && !cfg.keep_edge_files) std::remove(path.c_str());
+        return src;
+    }
+    return EdgeSource(p);
+}
+
+static std::string mean_layout(const MeanResult& res) {
+    return " [B=" + std::to_string(res.bucket_bits) + (res.fine_bits ? "+" + std::to_string(res.fine_bits) : std::string()) +
+           " P=" + std::to_string(res.passes) + " entry=" + std::to_string(res.entry_bytes) + "B]";
+}
+
+// Threads given to recovery and to trimming when pipelined; they add up to cfg.threads except at
+// one thread, where each side gets one
+static uint32_t pipelined_recovery_threads(const BenchConfig& cfg) {
+    return cfg.recovery_threads ? cfg.recovery_threads : std::max(1U, cfg.threads / 4);
+}
+static uint32_t pipelined_trim_threads(const BenchConfig& cfg) {
+    const uint32_t r = pipelined_recovery_threads(cfg);
+    return cfg.threads > r ? cfg.threads - r : 1U;
+}
+
+// Lean or mean with pipeline_depth > 1: the calling thread trims graph g+1 while a recovery
+// thread finishes graph g. Trimmed graphs wait in order for recovery; at most pipeline_depth
+// graphs are in flight (being trimmed, queued or recovering), each holding its surviving-edge
+// bitset. cfg.threads is split between the two (pipelined_recovery_threads). One graph's
+// recovery tables sit next to the next graph's trimming state, so the per-graph memcap doesn't
+// bound the process. Each graph is charged the wall time since the previous graph completed,
+// so total_wall_s is the run's wall time and gps its sustained rate.
+static void run_pipelined(const BenchConfig& cfg, BenchStats& stats) {
+    struct Job {
+        uint32_t a = 0;
+        Params p;
+        std::string header;
+        const CorpusEntry* entry = nullptr;
+        std::unique_ptr<LeanSolver> lean;
+        std::unique_ptr<MeanSolver> mean;
+        SummaryBitset edge_alive;
+        LeanResult lean_res;
+        MeanResult mean_res;
+        std::string error;
+        double trim_s = 0.0;
+    };
+
+    BenchConfig trim_cfg = cfg;
+    trim_cfg.threads = pipelined_trim_threads(cfg);
+    const uint32_t recovery_threads = pipelined_recovery_threads(cfg);
+
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<std::unique_ptr<Job>> ready;
+    uint32_t in_flight = 0;
+    bool done = false;
+
+    uint64_t last = now_ns();
+    std::thread recovery([&] {
+        for (;;) {
+            std::unique_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lk(mu);
+                cv.wait(lk, [&] { return done || !ready.empty(); });
+                if (ready.empty()) return;
+                job = std::move(ready.front());
+                ready.pop_front();
+            }
+
+            const uint64_t r0 = now_ns();
+            std::vector<std::vector<uint64_t>> solutions;
+            std::string note = job->error;
+            double mem_bpe = 0.0;
+            if (note.empty()) {
+                try {
+                    if (job->lean) {
+                        job->lean->recover(job->edge_alive, cfg.cycle_length, job->lean_res);
+                        solutions = std::move(job->lean_res.solutions);
+                        mem_bpe = job->lean_res.mem_bytes_per_edge;
+                        note = job->lean_res.note;
+                    } else {
+                        job->mean->recover(job->edge_alive, cfg.cycle_length, job->mean_res);
+                        stats.scatter_bytes += job->mean_res.scatter_bytes;
+                        stats.scatter_s += job->mean_res.scatter_s;
+                        solutions = std::move(job->mean_res.solutions);
+                        mem_bpe = job->mean_res.mem_bytes_per_edge;
+                        note = job->mean_res.note + mean_layout(job->mean_res);
+                    }
+                } catch (const std::exception& e) {
+                    solutions.clear();
+                    note = std::string("Exception: ") + e.what();
+                }
+                std::ostringstream lat;
+                lat << std::fixed << std::setprecision(3) << " [pipelined: trim " << job->trim_s << "s, recover "
+                    << ns_to_s(now_ns() - r0) << "s]";
+                note += lat.str();
+            }
+            SummaryBitset().swap(job->edge_alive);
 
+            const uint64_t t = now_ns();
+            record_attempt(cfg, stats, job->a, job->p, job->header, job->entry, solutions, note, ns_to_s(t - last));
+            last = t;
+            if (cfg.mode == "lean" && job->a == 0) stats.mem_bpe = mem_bpe;
+            if (cfg.mode == "mean") stats.mem_bpe = std::max(stats.mem_bpe, mem_bpe);
+
+            job.reset();
+            {
+                std::lock_guard<std::mutex> lk(mu);
+                --in_flight;
+            }
+            cv.notify_all();
+        }
+    });
+
+    HeaderSource source(cfg);
+    for (uint32_t a = 0; a < cfg.attempts; ++a) {
+        {
+            std::unique_lock<std::mutex> lk(mu);
+            cv.wait(lk, [&] { return in_flight < cfg.pipeline_depth; });
+            ++in_flight;
+        }
+
+        std::unique_ptr<Job> job(new Job());
+        job->a = a;
+        set_edge_bits(job->p, cfg.edge_bits);
+        job->header = source.next(job->p, &job->entry);
+        job->p.variant = cfg.variant;
+        job->p.family = cfg.family;
+
+        const uint64_t t0 = now_ns();
         try {
+            const EdgeSource edges = make_edge_source(cfg, job->p);
             if (cfg.mode == "lean") {
-                LeanSolver solver(p, cfg.threads, cfg.memcap_bpe);
-                auto res = solver.solve(256, cfg.cycle_length);
-                success = res.success;
-                solution = std::move(res.solution_edges);
-                mem_bpe = res.mem_bytes_per_edge;
-                note = res.note;
+                job->lean = make_lean(trim_cfg, job->p, edges);
+                job->lean->set_recovery_threads(recovery_threads);
+                job->lean_res = job->lean->trim(job->edge_alive, 256, cfg.cycle_length);
             } else if (cfg.mode == "mean") {
-                MeanSolver solver(p, cfg.threads, cfg.bucket_bits);
-                auto res = solver.solve(8, cfg.cycle_length);
-                success = res.success;
-                solution = std::move(res.solution_edges);
-                note = res.note;
+                job->mean = make_mean(trim_cfg, job->p, edges);
+                job->mean->set_recovery_threads(recovery_threads);
+                job->mean_res = job->mean->trim(job->edge_alive, 8, cfg.cycle_length);
             } else {
                 throw std::runtime_error("Unknown mode: " + cfg.mode);
             }
         } catch (const std::exception& e) {
-            success = false;
-            note = std::string("Exception: ") + e.what();
+            job->error = std::string("Exception: ") + e.what();
         }
+        job->trim_s = ns_to_s(now_ns() - t0);
 
-        uint64_t t1 = now_ns();
-        double dt = ns_to_s(t1 - t0);
-        stats.total_wall_s += dt;
-
-        if (success) {
-            // Verify solution (supports arbitrary k)
-            std::string err;
-            if (verify_cycle_k(p, solution, cfg.cycle_length, &err)) {
-                stats.successes++;
-                stats.times_success_s.push_back(dt);
-                std::cout << "Solution edges (" << cfg.cycle_length << "): ";
-                for (size_t k = 0; k < solution.size(); ++k) { if (k) std::cout << ","; std::cout << solution[k]; }
-                std::cout << "\n";
-            } else {
-                std::cerr << "Verification failed: " << err << "\n";
-                success = false;
-            }
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            ready.push_back(std::move(job));
         }
+        cv.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        done = true;
+    }
+    cv.notify_all();
+    recovery.join();
+}
+
+BenchStats run_bench(const BenchConfig& cfg) {
+    BenchStats stats;
+    stats.attempts = cfg.attempts;
+
+    if (cfg.mode == "lean" && cfg.batch > 1) {
+        run_lean_batched(cfg, stats);
+    } else if (cfg.pipeline_depth > 1) {
+        run_pipelined(cfg, stats);
+    } else {
+        HeaderSource source(cfg);
+        for (uint32_t a = 0; a < cfg.attempts; ++a) {
+            Params p;
+            set_edge_bits(p, cfg.edge_bits);
+            const CorpusEntry* entry = nullptr;
+            const std::string header = source.next(p, &entry);
+            p.variant = cfg.variant;
+            p.family = cfg.family;
+
+            // Table backends are built (or mapped) outside the timed solve
+            EdgeSource edges(p);
+            try {
+                edges = make_edge_source(cfg, p);
+            } catch (const std::exception& e) {
+                record_attempt(cfg, stats, a, p, header, entry, {}, std::string("Exception: ") + e.what(), 0.0);
+                continue;
+            }
+
+            uint64_t t0 = now_ns();
+            std::vector<std::vector<uint64_t>> solutions;
+            double mem_bpe = 0.0;
+            std::string note;
+            PerfReport perf;
+            MemReport mem;
 
-        if (a == 0 && cfg.mode == "lean") stats.mem_bpe = mem_bpe;
+            try {
+                if (cfg.mode == "lean") {
+                    auto res = make_lean(cfg, p, edges)->solve(256, cfg.cycle_length);
+                    perf = std::move(res.perf);
+                    mem = res.mem;
+                    solutions = std::move(res.solutions);
+                    mem_bpe = res.mem_bytes_per_edge;
+                    note = res.note;
+                } else if (cfg.mode == "mean") {
+                    auto res = make_mean(cfg, p, edges)->solve(8, cfg.cycle_length);
+                    stats.scatter_bytes += res.scatter_bytes;
+                    stats.scatter_s += res.scatter_s;
+                    perf = std::move(res.perf);
+                    mem = res.mem;
+                    solutions = std::move(res.solutions);
+                    mem_bpe = res.mem_bytes_per_edge;
+                    note = res.note + mean_layout(res);
+                } else {
+                    throw std::runtime_error("Unknown mode: " + cfg.mode);
+                }
+            } catch (const std::exception& e) {
+                solutions.clear();
+                note = std::string("Exception: ") + e.what();
+            }
+
+            uint64_t t1 = now_ns();
+            record_attempt(cfg, stats, a, p, header, entry, solutions, note, ns_to_s(t1 - t0));
+            if (perf.enabled) {
+                stats.perf.merge(perf);
+                if (!cfg.quiet) print_perf(perf, "  ");
+            }
+            if (mem.enabled) {
+                stats.mem.merge(mem);
+                if (!cfg.quiet) print_mem(mem, "  ");
+            }
 
-        std::cout << std::fixed << std::setprecision(6)
-                  << "Attempt " << (a + 1) << "/" << cfg.attempts
-                  << ", header= " << header
-                  << ", success= " << (success ? "yes" : "no")
-                  << ", time_s= " << dt
-                  << (note.empty() ? "" : (std::string(", note= ") + note))
-                  << "\n";
+            if (cfg.mode == "lean" && a == 0) stats.mem_bpe = mem_bpe;
+            if (cfg.mode == "mean") stats.mem_bpe = std::max(stats.mem_bpe, mem_bpe);
+        }
     }
 
     if (!stats.times_success_s.empty()) {
@@ -106,21 +511,214 @@ BenchStats run_bench(const BenchConfig& cfg) {
         stats.gps = 0.0;
     }
 
+    if (!stats.times_all_s.empty()) {
+        auto v = stats.times_all_s;
+        std::sort(v.begin(), v.end());
+        stats.p50_time_s = percentile(v, 0.50);
+        stats.p90_time_s = percentile(v, 0.90);
+        stats.p99_time_s = percentile(v, 0.99);
+    }
+
+    if (cfg.quiet) return stats;
+
     std::cout << "\nSummary:\n";
     std::cout << "  mode           : " << cfg.mode << "\n";
     std::cout << "  hash variant   : " << (cfg.variant == SipHashVariant::SipHash12 ? "sip12" : "sip24") << "\n";
+    std::cout << "  graph          : " << graph_family_name(cfg.family) << "\n";
+    if (cfg.edges != EdgeSourceKind::Hash) {
+        std::cout << "  edges          : " << edge_source_name(cfg.edges) << " (table built outside the timed solve)\n";
+    }
     std::cout << "  edge_bits      : " << cfg.edge_bits << "\n";
     std::cout << "  attempts       : " << cfg.attempts << "\n";
-    if (cfg.mode == "mean") { std::cout << "  bucket_bits    : " << cfg.bucket_bits << "\n"; }
+    if (cfg.mode == "mean") {
+        std::cout << "  bucket_bits    : " << cfg.bucket_bits;
+        if (cfg.fine_bucket_bits) std::cout << " + " << cfg.fine_bucket_bits << " in-cache";
+        std::cout << "\n";
+    }
+    if (cfg.mode == "mean" && cfg.hash_threads && cfg.scatter_threads) {
+        std::cout << "  pipeline       : " << cfg.hash_threads << " hash x " << cfg.scatter_threads << " scatter threads\n";
+    }
+    if (cfg.mode == "mean" && stats.scatter_s > 0.0) {
+        std::cout << "  scatter bw     : " << std::setprecision(3) << stats.scatter_bytes / stats.scatter_s / 1e9 << " GB/s ("
+                  << (stats.scatter_bytes >> 20) << " MiB, " << (cfg.nt_stores ? "streaming" : "cached") << " stores)\n";
+    }
+    if (cfg.mode == "lean" && cfg.batch > 1) { std::cout << "  batch          : " << cfg.batch << "\n"; }
+    if (cfg.pipeline_depth > 1) {
+        std::cout << "  pipeline depth : " << cfg.pipeline_depth << " (recovery on " << pipelined_recovery_threads(cfg)
+                  << " threads overlaps the next graph's trimming on " << pipelined_trim_threads(cfg) << ")\n";
+    }
     std::cout << "  successes      : " << stats.successes << "\n";
+    if (stats.errors) std::cout << "  errors         : " << stats.errors << " (excluded from p50/p90/p99)\n";
+    std::cout << "  solutions      : " << stats.solutions << " (" << std::setprecision(3)
+              << (stats.attempts ? static_cast<double>(stats.solutions) / stats.attempts : 0.0) << " per graph)\n";
     std::cout << std::fixed << std::setprecision(6);
     std::cout << "  total_wall_s   : " << stats.total_wall_s << "\n";
     std::cout << "  median_t/succ  : " << stats.median_time_success_s << "\n";
     std::cout << "  geomean_t/succ : " << stats.geomean_time_success_s << "\n";
     std::cout << "  gps            : " << stats.gps << "\n";
-    if (cfg.mode == "lean") { std::cout << "  mem bytes/edge : " << stats.mem_bpe << "\n"; }
+    std::cout << "  p50/p90/p99 t  : " << stats.p50_time_s << " / " << stats.p90_time_s << " / " << stats.p99_time_s << "\n";
+    if (stats.known_cycles) { std::cout << "  known cycles   : " << stats.known_found << "/" << stats.known_cycles << " found\n"; }
+    if (stats.perf.enabled) { std::cout << "  counters (all attempts):\n"; print_perf(stats.perf, "    "); }
+    if (stats.mem.enabled) { std::cout << "  memory (largest attempt):\n"; print_mem(stats.mem, "    "); }
+    std::cout << "  mem bytes/edge : " << stats.mem_bpe << (cfg.mode == "mean" ? " (measured peak)" : "") << "\n";
 
     return stats;
 }
 
+using MatrixKey = std::tuple<std::string, uint32_t, uint32_t, uint32_t>;
+
+static const char* kCsvHeader =
+    "mode,edge_bits,bucket_bits,threads,attempts,successes,p50_s,p90_s,p99_s,mean_s,gps,errors";
+
+static void write_csv(const std::string& path, const std::vector<BenchRow>& rows) {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("Cannot write CSV: " + path);
+    out << kCsvHeader << "\n" << std::setprecision(9);
+    for (const auto& r : rows) {
+        const auto& s = r.stats;
+        const double mean = s.attempts ? s.total_wall_s / s.attempts : 0.0;
+        const double gps = s.total_wall_s > 0.0 ? s.attempts / s.total_wall_s : 0.0;
+        out << r.mode << "," << r.edge_bits << "," << r.bucket_bits << "," << r.threads << ","
+            << s.attempts << "," << s.successes << "," << s.p50_time_s << "," << s.p90_time_s << ","
+            << s.p99_time_s << "," << mean << "," << gps << "," << s.errors << "\n";
+    }
+}
+
+static void write_json(const std::string& path, const BenchMatrixConfig& mc, const std::vector<BenchRow>& rows) {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("Cannot write JSON: " + path);
+    out << std::setprecision(9);
+    out << "{\n  \"cycle_length\": " << mc.base.cycle_length
+        << ",\n  \"hash\": \"" << (mc.base.variant == SipHashVariant::SipHash12 ? "sip12" : "sip24") << "\""
+        << ",\n  \"graph\": \"" << graph_family_name(mc.base.family) << "\""
+        << ",\n  \"seed\": " << (mc.base.seeded ? std::to_string(mc.base.seed) : std::string("null"))
+        << ",\n  \"corpus_size\": " << mc.base.corpus.size()
+        << ",\n  \"rows\": [";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const auto& r = rows[i];
+        const auto& s = r.stats;
+        out << (i ? "," : "") << "\n    {\"mode\": \"" << r.mode << "\", \"edge_bits\": " << r.edge_bits
+            << ", \"bucket_bits\": " << r.bucket_bits << ", \"threads\": " << r.threads
+            << ", \"attempts\": " << s.attempts << ", \"successes\": " << s.successes << ", \"errors\": " << s.errors
+            << ", \"solutions\": " << s.solutions << ", \"known_cycles\": " << s.known_cycles << ", \"known_found\": " << s.known_found
+            << ", \"p50_s\": " << s.p50_time_s << ", \"p90_s\": " << s.p90_time_s << ", \"p99_s\": " << s.p99_time_s
+            << ", \"total_wall_s\": " << s.total_wall_s;
+        if (s.scatter_s > 0.0) out << ", \"scatter_gbps\": " << s.scatter_bytes / s.scatter_s / 1e9;
+        out << ", \"times_s\": [";
+        for (size_t k = 0; k < s.times_all_s.size(); ++k) out << (k ? ", " : "") << s.times_all_s[k];
+        out << "]";
+        if (s.mem.enabled) {
+            out << ", \"mem\": {\"tracked_peak_bytes\": " << s.mem.tracked_peak_bytes << ", \"rss_peak_kb\": " << s.mem.rss_peak_kb
+                << ", \"phase_rss_exact\": " << (s.mem.phase_rss_exact ? "true" : "false");
+            for (size_t t = 0; t < kMemTagCount; ++t) {
+                out << ", \"" << mem_tag_name(static_cast<MemTag>(t)) << "\": {\"peak_bytes\": " << s.mem.tags[t].peak_bytes
+                    << ", \"allocs\": " << s.mem.tags[t].allocs << "}";
+            }
+            for (size_t ph = 0; ph < kPhaseCount; ++ph) {
+                out << ", \"" << phase_name(static_cast<Phase>(ph)) << "_rss_kb\": " << s.mem.phase_rss_peak_kb[ph];
+            }
+            out << ", \"round_rss_kb\": [";
+            for (size_t k = 0; k < s.mem.round_rss_kb.size(); ++k) out << (k ? ", " : "") << s.mem.round_rss_kb[k];
+            out << "]";
+            out << "}";
+        }
+        if (s.perf.enabled) {
+            out << ", \"perf\": {\"available\": " << (s.perf.available ? "true" : "false");
+            for (size_t ph = 0; ph < kPhaseCount; ++ph) {
+                const PerfSample& c = s.perf.phases[ph];
+                out << ", \"" << phase_name(static_cast<Phase>(ph)) << "\": {\"wall_s\": " << ns_to_s(c.wall_ns)
+                    << ", \"cycles\": " << c.cycles << ", \"instructions\": " << c.instructions
+                    << ", \"llc_misses\": " << c.llc_misses << ", \"dtlb_misses\": " << c.dtlb_misses
+                    << ", \"branch_misses\": " << c.branch_misses << "}";
+            }
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Baseline p50 per cell, read from a CSV written by write_csv; cells that had errors are skipped.
+static std::map<MatrixKey, double> load_baseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open baseline: " + path);
+    std::map<MatrixKey, double> out;
+    std::string line;
+    std::getline(in, line);
+    // Baselines written before the errors column are still accepted
+    const std::string header = kCsvHeader;
+    if (line != header && line != header.substr(0, header.rfind(',')))
+        throw std::runtime_error("Unexpected baseline header in " + path);
+    while (std::getline(in, line)) {
+        auto f = split_list(line);
+        if (f.size() < 7) continue;
+        if (f.size() > 11 && std::stoul(f[11]) > 0) continue;
+        out[MatrixKey{ f[0], static_cast<uint32_t>(std::stoul(f[1])), static_cast<uint32_t>(std::stoul(f[2])),
+                       static_cast<uint32_t>(std::stoul(f[3])) }] = std::stod(f[6]);
+    }
+    return out;
+}
+
+int run_bench_matrix(const BenchMatrixConfig& config) {
+    // Cells, and runs compared against a baseline, must solve the same graphs: headers past the
+    // corpus come from a fixed seed unless one is given
+    BenchMatrixConfig mc = config;
+    if (!mc.base.seeded) {
+        mc.base.seeded = true;
+        mc.base.seed = kMatrixSeed;
+        std::cout << "Headers: --seed " << kMatrixSeed << " (matrix default)\n";
+    }
+    std::vector<BenchRow> rows;
+    for (const auto& mode : mc.modes) {
+        for (uint32_t eb : mc.edge_bits) {
+            // bucket_bits only applies to mean; lean cells run once
+            std::vector<uint32_t> bbs = (mode == "mean") ? mc.bucket_bits : std::vector<uint32_t>{ 0 };
+            for (uint32_t bb : bbs) {
+                for (uint32_t t : mc.threads) {
+                    BenchConfig cfg = mc.base;
+                    cfg.mode = mode;
+                    cfg.edge_bits = eb;
+                    cfg.bucket_bits = (mode == "mean") ? bb : mc.base.bucket_bits;
+                    cfg.threads = t;
+                    cfg.quiet = true;
+                    BenchRow row{ mode, eb, bb, t, run_bench(cfg) };
+                    std::cout << std::fixed << std::setprecision(6)
+                              << "Cell mode= " << mode << ", edge_bits= " << eb << ", bucket_bits= " << bb
+                              << ", threads= " << t << ", successes= " << row.stats.successes << "/" << row.stats.attempts
+                              << ", p50/p90/p99_s= " << row.stats.p50_time_s << "/" << row.stats.p90_time_s
+                              << "/" << row.stats.p99_time_s
+                              << (row.stats.errors ? ", errors= " + std::to_string(row.stats.errors) : std::string()) << "\n";
+                    rows.push_back(std::move(row));
+                }
+            }
+        }
+    }
+
+    if (!mc.csv_path.empty()) write_csv(mc.csv_path, rows);
+    if (!mc.json_path.empty()) write_json(mc.json_path, mc, rows);
+    if (mc.baseline_path.empty()) return 0;
+
+    const auto base = load_baseline(mc.baseline_path);
+    int regressions = 0;
+    std::cout << "\nBaseline comparison (p50, threshold " << mc.regress_threshold * 100.0 << "%):\n";
+    for (const auto& r : rows) {
+        // A cell whose attempts threw has no comparable p50; it fails the check outright
+        if (r.stats.errors) {
+            ++regressions;
+            std::cout << "  " << r.mode << " eb=" << r.edge_bits << " bb=" << r.bucket_bits << " t=" << r.threads
+                      << ": " << r.stats.errors << "/" << r.stats.attempts << " attempts threw  ERROR\n";
+            continue;
+        }
+        auto it = base.find(MatrixKey{ r.mode, r.edge_bits, r.bucket_bits, r.threads });
+        if (it == base.end() || it->second <= 0.0) continue;
+        const double ratio = r.stats.p50_time_s / it->second;
+        const bool regressed = ratio > 1.0 + mc.regress_threshold;
+        if (regressed) ++regressions;
+        std::cout << "  " << r.mode << " eb=" << r.edge_bits << " bb=" << r.bucket_bits << " t=" << r.threads
+                  << ": " << it->second << " -> " << r.stats.p50_time_s << " (x" << ratio << ")"
+                  << (regressed ? "  REGRESSION" : "") << "\n";
+    }
+    return regressions;
+}
+
 } // namespace cuckoo_sip
@@ -6,9 +6,23 @@
 #include <string>
 
 #include "cuckoo/graph.h"
+#include "cuckoo/edge_source.h"
+#include "perf_counters.h"
+#include "mem_track.h"
 
 namespace cuckoo_sip {
 
+// One header from a benchmark corpus. edge_bits/cycle_length are nonzero when the header is
+// known to contain a cycle of that length at that edge_bits.
+struct CorpusEntry {
+    std::string header;
+    uint32_t edge_bits = 0;
+    uint32_t cycle_length = 0;
+};
+
+// Loads "HEADER [EDGE_BITS K]" lines; '#' starts a comment. Throws if the file can't be read.
+std::vector<CorpusEntry> load_header_corpus(const std::string& path);
+
 struct BenchConfig {
     std::string mode;         // "lean" or "mean"
     uint32_t edge_bits = 29;
@@ -17,23 +31,82 @@ struct BenchConfig {
     uint32_t cycle_length = 42;
     uint32_t bucket_bits = 12; // mean solver bucket radix bits
     SipHashVariant variant = SipHashVariant::SipHash12;
-    double memcap_bpe = 1.0;  // used in lean mode only
+    GraphFamily family = GraphFamily::PerEdge;
+    EdgeSourceKind edges = EdgeSourceKind::Hash; // endpoints hashed on the fly or read from a table
+    std::string edge_dir;     // mmap: directory of endpoint files (default ".")
+    bool keep_edge_files = false; // mmap: keep endpoint files this run writes (else removed after mapping)
+    double memcap_bpe = 0.0;  // 0 = solver default (lean 1.0, mean unbounded)
     std::string header_hex;   // optional fixed key from hex; if empty, random per attempt
+    uint32_t batch = 1;       // lean only: graphs trimmed in lockstep per solver call
+    std::vector<CorpusEntry> corpus; // headers used in order (entries for other edge_bits skipped)
+    bool seeded = false;      // draw headers from seed instead of std::random_device
+    uint64_t seed = 0;
+    bool quiet = false;       // suppress per-attempt lines and the summary block
+    bool perf = false;        // capture per-phase hardware counters (lean/mean, not batched)
+    bool mem = false;         // report tracked bytes per structure and peak RSS per phase
+    uint32_t hash_threads = 0;    // mean only: pipelined seeding hashers (0 = inline scatter)
+    uint32_t scatter_threads = 0; // mean only: pipelined seeding bucket writers
+    uint32_t prefetch = 0;        // lean only: edges in flight for bitmap prefetching (0 = off)
+    bool bounded_recovery = false; // lean only: skip recovery that would exceed the memcap
+    bool nt_stores = false;       // mean only: stage bucket lines, write them with streaming stores
+    uint32_t fine_bucket_bits = 0; // mean only: second radix level applied in cache before counting
+    bool fused = false;           // lean/mean: side passes filter and count the next side in one scan
+    uint32_t pipeline_depth = 1;  // graphs in flight; > 1 overlaps recovery with the next trim (no perf/mem)
+    uint32_t recovery_threads = 0; // pipeline_depth > 1: recovery's share of threads (0 = threads / 4, at least 1)
 };
 
 struct BenchStats {
     uint32_t attempts = 0;
-    uint32_t successes = 0;
+    uint32_t successes = 0;           // graphs with at least one verified solution
+    uint64_t solutions = 0;           // verified k-cycles over all graphs
     double total_wall_s = 0.0;
     double median_time_success_s = 0.0;
     double geomean_time_success_s = 0.0;
     double gps = 0.0; // graphs per second per success measure
-    double mem_bpe = 0.0; // lean solver theoretical mem per edge
+    double mem_bpe = 0.0; // lean: theoretical mem per edge; mean: largest measured peak per edge
     std::vector<double> times_success_s;
+    std::vector<double> times_all_s;   // per-graph time of every attempt that ran, unsolved ones included
+    uint32_t errors = 0;               // attempts that threw; kept out of times_all_s
+    double p50_time_s = 0.0;           // percentiles over times_all_s
+    double p90_time_s = 0.0;
+    double p99_time_s = 0.0;
+    uint32_t known_cycles = 0;         // corpus headers advertising a cycle_length cycle at this edge_bits
+    uint32_t known_found = 0;          // ... of which the solver found a verified solution
+    PerfReport perf;                   // per-phase counters summed over attempts (cfg.perf)
+    MemReport mem;                     // largest per-attempt footprints (cfg.mem)
+    uint64_t scatter_bytes = 0;        // mean: bucket entry bytes scattered over all attempts
+    double scatter_s = 0.0;            // ... and the time spent scattering them
 };
 
 BenchStats run_bench(const BenchConfig& cfg);
 
+// mode x edge_bits x bucket_bits x threads sweep; every cell sees the same header sequence. Without
+// base.seeded, headers past the corpus are drawn from kMatrixSeed so reruns solve the same graphs.
+constexpr uint64_t kMatrixSeed = 1;
+struct BenchMatrixConfig {
+    BenchConfig base;                   // attempts, cycle length, hash, corpus/seed, ...
+    std::vector<std::string> modes;
+    std::vector<uint32_t> edge_bits;
+    std::vector<uint32_t> bucket_bits;  // mean only; lean cells run once with bucket_bits 0
+    std::vector<uint32_t> threads;
+    std::string csv_path;               // optional outputs
+    std::string json_path;
+    std::string baseline_path;          // CSV from an earlier run to compare against
+    double regress_threshold = 0.10;    // flag cells whose p50 grew by more than this fraction
+};
+
+struct BenchRow {
+    std::string mode;
+    uint32_t edge_bits = 0;
+    uint32_t bucket_bits = 0;
+    uint32_t threads = 0;
+    BenchStats stats;
+};
+
+// Runs every cell, writes CSV/JSON if requested and returns the number of cells that regressed
+// against the baseline (0 when no baseline is given).
+int run_bench_matrix(const BenchMatrixConfig& mc);
+
 } // namespace cuckoo_sip
 
 #endif // CUCKOO_SIP_BENCH_H
@@ -2,26 +2,63 @@
 #include <string>
 #include <vector>
 #include <cstdlib>
+#include <algorithm>
 
 #include "bench/bench.h"
+#include "bench/autotune.h"
+#include "util.h"
 
 using namespace cuckoo_sip;
 
+static std::vector<uint32_t> parse_u32_list(const std::string& s) {
+    std::vector<uint32_t> out;
+    for (const auto& f : split_list(s)) out.push_back(static_cast<uint32_t>(std::stoul(f)));
+    return out;
+}
+
 static void print_help(const char* prog) {
     std::cout << "Usage: " << prog << " [options]\n"
-              << "  --mode {lean,mean}\n"
-              << "  --edge-bits N\n"
-              << "  --threads T\n"
+              << "  --mode {lean,mean}[,...]\n"
+              << "  --edge-bits N[,...]\n"
+              << "  --threads T[,...]\n"
               << "  --attempts A\n"
               << "  --cycle-length K\n"
-              << "  --bucket-bits B            (mean only)\n"
+              << "  --bucket-bits B[,...]       (mean only)\n"
               << "  --hash {sip12,sip24}\n"
-              << "  --memcap-bytes-per-edge X   (lean only)\n"
-              << "  --header HEX                (optional 16-byte hex for key)\n";
+              << "  --graph {sip,block64}       (per-edge SipHash or 64-edge keystream blocks)\n"
+              << "  --edges {hash,ram,mmap}     (endpoints on the fly, precomputed in RAM, or from a mapped file)\n"
+              << "  --edge-dir DIR              (mmap: where endpoint files are kept/generated, default .)\n"
+              << "  --keep-edge-files           (mmap: keep files this run writes for reuse; default removes them)\n"
+              << "  --memcap-bytes-per-edge X   (lean: default 1; mean: default unbounded)\n"
+              << "  --header HEX                (optional 16-byte hex for key)\n"
+              << "  --hash-threads H            (mean only; pipelined seeding, with --scatter-threads)\n"
+              << "  --scatter-threads S         (mean only; bucket writer threads fed by the hashers)\n"
+              << "  --prefetch N                (lean only; edges in flight for bitmap prefetching, max 256)\n"
+              << "  --bounded-recovery          (lean only; recovery must fit the memcap too, else more trimming)\n"
+              << "  --nt-stores                 (mean only; stream full bucket lines past the cache)\n"
+              << "  --fine-bucket-bits F        (mean only; split large buckets by F more bits in cache)\n"
+              << "  --fused                     (one scan per side pass: filter and count the next side together)\n"
+              << "  --batch G                   (lean only, experimental; trim G graphs in lockstep)\n"
+              << "  --pipeline-depth D          (graphs in flight; recovery of one overlaps trimming of the next)\n"
+              << "  --recovery-threads R        (with --pipeline-depth; recovery's share of --threads, default threads/4)\n"
+              << "  --corpus FILE               (headers, one per line: HEADER [EDGE_BITS K])\n"
+              << "  --seed S                    (reproducible headers after the corpus)\n"
+              << "  --csv FILE / --json FILE    (matrix results)\n"
+              << "  --baseline FILE             (CSV to compare p50 against; exit 2 on regression)\n"
+              << "  --regress-threshold X       (fractional p50 slowdown flagged, default 0.10)\n"
+              << "  --perf                      (per-phase hardware counters via perf_event_open)\n"
+              << "  --mem-report                (tracked bytes per structure, peak RSS per phase)\n"
+              << "  --autotune                  (probe mode/bucket-bits/threads for --edge-bits, save profile)\n"
+              << "  --probe-attempts A          (graphs per autotune candidate, default 3)\n"
+              << "  --profile FILE              (default $CUCKOO_SIP_PROFILE or ~/.cuckoo_sip_profile)\n"
+              << "  --no-profile                (ignore the saved profile)\n"
+              << "Comma lists in --mode/--edge-bits/--bucket-bits/--threads run the full matrix.\n"
+              << "Single runs take mode/bucket-bits/threads/memcap from the profile unless given explicitly.\n";
 }
 
 int main(int argc, char** argv) {
     BenchConfig cfg;
+    BenchMatrixConfig mc;
     cfg.mode = "lean";
     cfg.edge_bits = 20;
     cfg.threads = 1;
@@ -29,7 +66,12 @@ int main(int argc, char** argv) {
     cfg.cycle_length = 42;
     cfg.bucket_bits = 12;
     cfg.variant = SipHashVariant::SipHash12;
-    cfg.memcap_bpe = 1.0;
+    cfg.memcap_bpe = 0.0;
+    bool autotune = false;
+    bool use_profile = true;
+    bool memcap_set = false;
+    uint32_t probe_attempts = 3;
+    std::string profile_path = default_profile_path();
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -39,22 +81,145 @@ int main(int argc, char** argv) {
                 std::exit(1);
             }
         };
-        if (arg == "--mode") { need(1); cfg.mode = argv[++i]; }
-        else if (arg == "--edge-bits") { need(1); cfg.edge_bits = static_cast<uint32_t>(std::stoul(argv[++i])); }
-        else if (arg == "--threads") { need(1); cfg.threads = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        if (arg == "--mode") { need(1); mc.modes = split_list(argv[++i]); }
+        else if (arg == "--edge-bits") { need(1); mc.edge_bits = parse_u32_list(argv[++i]); }
+        else if (arg == "--threads") { need(1); mc.threads = parse_u32_list(argv[++i]); }
         else if (arg == "--attempts") { need(1); cfg.attempts = static_cast<uint32_t>(std::stoul(argv[++i])); }
         else if (arg == "--cycle-length") { need(1); cfg.cycle_length = static_cast<uint32_t>(std::stoul(argv[++i])); }
-        else if (arg == "--bucket-bits") { need(1); cfg.bucket_bits = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--bucket-bits") { need(1); mc.bucket_bits = parse_u32_list(argv[++i]); }
         else if (arg == "--hash") { need(1); std::string v = argv[++i]; if (v == "sip12") cfg.variant = SipHashVariant::SipHash12; else if (v == "sip24") cfg.variant = SipHashVariant::SipHash24; else { std::cerr << "Unknown --hash variant: " << v << "\n"; return 1; } }
-        else if (arg == "--memcap-bytes-per-edge") { need(1); cfg.memcap_bpe = std::stod(argv[++i]); }
+        else if (arg == "--graph") { need(1); std::string v = argv[++i]; if (v == "sip") cfg.family = GraphFamily::PerEdge; else if (v == "block64") cfg.family = GraphFamily::Block64; else { std::cerr << "Unknown --graph family: " << v << "\n"; return 1; } }
+        else if (arg == "--edges") { need(1); std::string v = argv[++i]; if (v == "hash") cfg.edges = EdgeSourceKind::Hash; else if (v == "ram") cfg.edges = EdgeSourceKind::Memory; else if (v == "mmap") cfg.edges = EdgeSourceKind::Mapped; else { std::cerr << "Unknown --edges source: " << v << "\n"; return 1; } }
+        else if (arg == "--edge-dir") { need(1); cfg.edge_dir = argv[++i]; }
+        else if (arg == "--keep-edge-files") { cfg.keep_edge_files = true; }
+        else if (arg == "--memcap-bytes-per-edge") { need(1); cfg.memcap_bpe = std::stod(argv[++i]); memcap_set = true; }
         else if (arg == "--header") { need(1); cfg.header_hex = argv[++i]; }
+        else if (arg == "--hash-threads") { need(1); cfg.hash_threads = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--scatter-threads") { need(1); cfg.scatter_threads = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--prefetch") { need(1); cfg.prefetch = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--bounded-recovery") { cfg.bounded_recovery = true; }
+        else if (arg == "--nt-stores") { cfg.nt_stores = true; }
+        else if (arg == "--fine-bucket-bits") { need(1); cfg.fine_bucket_bits = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--fused") { cfg.fused = true; }
+        else if (arg == "--batch") { need(1); cfg.batch = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--pipeline-depth") { need(1); cfg.pipeline_depth = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--recovery-threads") { need(1); cfg.recovery_threads = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--corpus") {
+            need(1);
+            try { cfg.corpus = load_header_corpus(argv[++i]); }
+            catch (const std::exception& e) { std::cerr << e.what() << "\n"; return 1; }
+        }
+        else if (arg == "--seed") { need(1); cfg.seeded = true; cfg.seed = std::stoull(argv[++i]); }
+        else if (arg == "--perf") { cfg.perf = true; }
+        else if (arg == "--mem-report") { cfg.mem = true; }
+        else if (arg == "--autotune") { autotune = true; }
+        else if (arg == "--probe-attempts") { need(1); probe_attempts = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--profile") { need(1); profile_path = argv[++i]; }
+        else if (arg == "--no-profile") { use_profile = false; }
+        else if (arg == "--csv") { need(1); mc.csv_path = argv[++i]; }
+        else if (arg == "--json") { need(1); mc.json_path = argv[++i]; }
+        else if (arg == "--baseline") { need(1); mc.baseline_path = argv[++i]; }
+        else if (arg == "--regress-threshold") { need(1); mc.regress_threshold = std::stod(argv[++i]); }
         else if (arg == "--help" || arg == "-h") { print_help(argv[0]); return 0; }
         else { std::cerr << "Unknown option: " << arg << "\n"; print_help(argv[0]); return 1; }
     }
 
-    if (cfg.mode != "lean" && cfg.mode != "mean") { std::cerr << "Invalid --mode: " << cfg.mode << "\n"; return 1; }
+    if (autotune) {
+        AutotuneConfig ac;
+        ac.edge_bits = mc.edge_bits.empty() ? std::vector<uint32_t>{ cfg.edge_bits } : mc.edge_bits;
+        ac.probe_attempts = std::max(1U, probe_attempts);
+        ac.cycle_length = cfg.cycle_length;
+        ac.variant = cfg.variant;
+        ac.family = cfg.family;
+        ac.seed = cfg.seeded ? cfg.seed : 1;
+        ac.profile_path = profile_path;
+        return run_autotune(ac);
+    }
 
-    if (cfg.edge_bits >= 32) { std::cerr << "Warning: edge_bits >= 32 may be impractical for this iteration.\n"; }
+    // Flags given explicitly, so the profile only fills in the rest
+    const bool mode_set = !mc.modes.empty();
+    const bool bb_set = !mc.bucket_bits.empty();
+    const bool threads_set = !mc.threads.empty();
+
+    if (mc.modes.empty()) mc.modes = { cfg.mode };
+    if (mc.edge_bits.empty()) mc.edge_bits = { cfg.edge_bits };
+    if (mc.bucket_bits.empty()) mc.bucket_bits = { cfg.bucket_bits };
+    if (mc.threads.empty()) mc.threads = { cfg.threads };
+    for (const auto& mode : mc.modes) {
+        if (mode != "lean" && mode != "mean") { std::cerr << "Invalid --mode: " << mode << "\n"; return 1; }
+    }
 
-    auto stats = run_bench(cfg); (void)stats; return 0;
+    const bool matrix = mc.modes.size() > 1 || mc.edge_bits.size() > 1 || mc.bucket_bits.size() > 1 ||
+                        mc.threads.size() > 1 || !mc.csv_path.empty() || !mc.json_path.empty() ||
+                        !mc.baseline_path.empty();
+    if (!matrix) {
+        cfg.mode = mc.modes[0];
+        cfg.edge_bits = mc.edge_bits[0];
+        cfg.bucket_bits = mc.bucket_bits[0];
+        cfg.threads = mc.threads[0];
+        // Flags that only one solver reads pin the mode the profile may pick
+        const bool lean_only = cfg.batch > 1 || cfg.prefetch > 0 || cfg.bounded_recovery;
+        const bool mean_only = bb_set || cfg.nt_stores || cfg.fine_bucket_bits > 0 || cfg.hash_threads || cfg.scatter_threads;
+        if (!mode_set && lean_only && mean_only) {
+            std::cerr << "Lean-only flags (--batch, --prefetch, --bounded-recovery) and mean-only flags (--bucket-bits, "
+                         "--nt-stores, --fine-bucket-bits, --hash-threads/--scatter-threads) need an explicit --mode\n";
+            return 1;
+        }
+        const std::string mode = mode_set ? cfg.mode : lean_only ? "lean" : mean_only ? "mean" : std::string();
+        if (!mode.empty()) cfg.mode = mode;
+        if (use_profile && (mode.empty() || !bb_set || !threads_set || !memcap_set)) {
+            const auto profile = load_profile(profile_path);
+            TunedConfig key;
+            key.edge_bits = cfg.edge_bits;
+            key.cycle_length = cfg.cycle_length;
+            key.variant = cfg.variant;
+            key.family = cfg.family;
+            if (const TunedConfig* e = find_profile_entry(profile, key, mode)) {
+                cfg.mode = e->mode;
+                if (!bb_set && e->mode == "mean") cfg.bucket_bits = e->bucket_bits;
+                if (!threads_set) cfg.threads = e->threads;
+                if (!memcap_set) cfg.memcap_bpe = e->memcap_bpe;
+                std::cout << "Profile " << profile_path << ": mode=" << cfg.mode << " bucket_bits=" << cfg.bucket_bits
+                          << " threads=" << cfg.threads << " memcap_bpe=" << cfg.memcap_bpe << "\n";
+            }
+        }
+    }
+
+    if (cfg.batch == 0) { std::cerr << "Invalid --batch: must be >= 1\n"; return 1; }
+    if (cfg.batch > 1 && cfg.family != GraphFamily::PerEdge) { std::cerr << "--batch supports --graph sip only\n"; return 1; }
+    if (cfg.batch > 1 && cfg.edges != EdgeSourceKind::Hash) { std::cerr << "--batch supports --edges hash only\n"; return 1; }
+    if (cfg.batch > 1 && cfg.perf) { std::cerr << "--batch doesn't support --perf\n"; return 1; }
+    if (cfg.fine_bucket_bits > 16) { std::cerr << "Invalid --fine-bucket-bits: must be <= 16\n"; return 1; }
+    if (cfg.pipeline_depth == 0) { std::cerr << "Invalid --pipeline-depth: must be >= 1\n"; return 1; }
+    if (cfg.pipeline_depth > 1 && cfg.batch > 1) { std::cerr << "--pipeline-depth and --batch are exclusive\n"; return 1; }
+    if (cfg.batch > 1) std::cerr << "Warning: --batch is experimental and slower than serial lean on most edge_bits.\n";
+    if (cfg.pipeline_depth > 1 && (cfg.perf || cfg.mem)) {
+        std::cerr << "--pipeline-depth doesn't support --perf or --mem-report (phases of two graphs overlap)\n";
+        return 1;
+    }
+    if (cfg.pipeline_depth > 1 && cfg.bounded_recovery) {
+        std::cerr << "--pipeline-depth doesn't support --bounded-recovery (recovery overlaps the next graph's trimming memory)\n";
+        return 1;
+    }
+    if (cfg.recovery_threads && cfg.pipeline_depth < 2) { std::cerr << "--recovery-threads needs --pipeline-depth >= 2\n"; return 1; }
+    if ((cfg.hash_threads == 0) != (cfg.scatter_threads == 0)) {
+        std::cerr << "--hash-threads and --scatter-threads must be given together\n";
+        return 1;
+    }
+
+    for (uint32_t eb : mc.edge_bits) {
+        if (eb >= 32) { std::cerr << "Warning: edge_bits >= 32 may be impractical for this iteration.\n"; break; }
+    }
+
+    if (!matrix) {
+        auto stats = run_bench(cfg); (void)stats; return 0;
+    }
+
+    mc.base = cfg;
+    try {
+        return run_bench_matrix(mc) > 0 ? 2 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
 }
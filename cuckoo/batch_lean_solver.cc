@@ -0,0 +1,205 @@
+#include "batch_lean_solver.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "components.h"
+#include "peeler.h"
+#include "recovery.h"
+
+namespace cuckoo_sip {
+
+BatchLeanSolver::BatchLeanSolver(const Params& params, const std::vector<SipHashKey>& keys, uint32_t threads,
+                                 double memcap_bytes_per_edge)
+    : p_(params), threads_(threads), memcap_bpe_(memcap_bytes_per_edge), G_(keys.size()) {
+    if (G_ == 0) throw std::runtime_error("Batch lean solver needs at least one key");
+    if (p_.family != GraphFamily::PerEdge)
+        throw std::runtime_error("Batch lean solver supports the per-edge graph family only");
+    if (mem_bytes_per_edge() > memcap_bpe_) {
+        throw std::runtime_error("Batch lean solver theoretical mem exceeds cap: " +
+                                 std::to_string(mem_bytes_per_edge()) + ">" + std::to_string(memcap_bpe_));
+    }
+    k0_.reserve(G_); k1_.reserve(G_);
+    for (const auto& k : keys) { k0_.push_back(k.k0); k1_.push_back(k.k1); }
+}
+
+size_t BatchLeanSolver::memory_usage_bytes() const {
+    // Per graph: edge_alive, new_edge_alive, seen, nonleaf (each N bits); sides share seen/nonleaf.
+    const size_t words = words_for_bits(p_.N);
+    return 4 * words * sizeof(uint64_t) + (words * sizeof(uint32_t) + G_ - 1) / G_;
+}
+
+double BatchLeanSolver::mem_bytes_per_edge() const {
+    if (p_.N == 0) return 0.0;
+    return static_cast<double>(memory_usage_bytes()) / static_cast<double>(p_.N);
+}
+
+void BatchLeanSolver::hash_lanes(uint64_t nonce, const uint64_t* k0, const uint64_t* k1, uint64_t* out,
+                                 size_t count) const {
+    if (p_.variant == SipHashVariant::SipHash12) siphash12_multikey(k0, k1, nonce, out, count);
+    else siphash24_multikey(k0, k1, nonce, out, count);
+    for (size_t l = 0; l < count; ++l) out[l] &= p_.node_mask;
+}
+
+void BatchLeanSolver::trim_side_all(const Words& edge_alive,
+                                    Words& new_edge_alive,
+                                    Words& seen,
+                                    Words& nonleaf,
+                                    const std::vector<uint8_t>& active,
+                                    std::vector<uint32_t>& live,
+                                    std::vector<uint64_t>& kept,
+                                    int side) const {
+    // Keys of the graphs an edge is alive in, gathered so only those lanes are hashed
+    std::vector<uint64_t> h(G_), lk0(G_), lk1(G_);
+    std::vector<uint32_t> lane(G_);
+
+    std::fill(seen.begin(), seen.end(), 0ULL);
+    std::fill(nonleaf.begin(), nonleaf.end(), 0ULL);
+    std::fill(kept.begin(), kept.end(), 0ULL);
+
+    // Union of the active graphs' alive bits for one 64-edge word
+    auto live_union = [&](size_t w) {
+        uint64_t m = 0;
+        const uint64_t* row = &edge_alive[w * G_];
+        for (size_t g = 0; g < G_; ++g) if (active[g]) m |= row[g];
+        return m;
+    };
+    auto gather = [&](const uint64_t* row, uint64_t b) {
+        size_t n = 0;
+        for (size_t g = 0; g < G_; ++g) {
+            if (!active[g] || !((row[g] >> b) & 1ULL)) continue;
+            lk0[n] = k0_[g]; lk1[n] = k1_[g]; lane[n++] = static_cast<uint32_t>(g);
+        }
+        return n;
+    };
+
+    // Pass 1: build seen/nonleaf for every active graph in one scan
+    for (const uint32_t w : live) {
+        uint64_t m = live_union(w);
+        const uint64_t* row = &edge_alive[static_cast<size_t>(w) * G_];
+        while (m) {
+            const uint64_t b = static_cast<uint64_t>(__builtin_ctzll(m));
+            m &= m - 1;
+            const uint64_t i = (static_cast<uint64_t>(w) << 6) | b;
+            const size_t n = gather(row, b);
+            hash_lanes((i << 1) | (static_cast<uint64_t>(side) & 1ULL), lk0.data(), lk1.data(), h.data(), n);
+            for (size_t l = 0; l < n; ++l) {
+                if (!bit_get(seen, h[l], lane[l])) bit_set(seen, h[l], lane[l]); else bit_set(nonleaf, h[l], lane[l]);
+            }
+        }
+    }
+
+    // Pass 2: keep edges whose endpoint on this side is nonleaf; drop words no active graph keeps
+    size_t n_live = 0;
+    for (const uint32_t w : live) {
+        const uint64_t* row = &edge_alive[static_cast<size_t>(w) * G_];
+        uint64_t* out = &new_edge_alive[static_cast<size_t>(w) * G_];
+        for (size_t g = 0; g < G_; ++g) out[g] = 0;
+        uint64_t m = live_union(w);
+        while (m) {
+            const uint64_t b = static_cast<uint64_t>(__builtin_ctzll(m));
+            m &= m - 1;
+            const uint64_t i = (static_cast<uint64_t>(w) << 6) | b;
+            const size_t n = gather(row, b);
+            hash_lanes((i << 1) | (static_cast<uint64_t>(side) & 1ULL), lk0.data(), lk1.data(), h.data(), n);
+            for (size_t l = 0; l < n; ++l) {
+                if (bit_get(nonleaf, h[l], lane[l])) { out[lane[l]] |= (1ULL << b); ++kept[lane[l]]; }
+            }
+        }
+        uint64_t any = 0;
+        for (size_t g = 0; g < G_; ++g) any |= out[g];
+        if (any) live[n_live++] = w;
+    }
+    live.resize(n_live);
+}
+
+void BatchLeanSolver::extract_graph(const Words& interleaved, const std::vector<uint32_t>& live, size_t g,
+                                    SummaryBitset& out) const {
+    out.reset(p_.N);
+    for (const uint32_t w : live) out.or_word(w, interleaved[static_cast<size_t>(w) * G_ + g]);
+}
+
+std::vector<LeanResult> BatchLeanSolver::solve(uint32_t max_rounds, uint32_t cycle_length) {
+    const uint64_t N = p_.N;
+    const size_t words_e = words_for_bits(N);
+    std::vector<LeanResult> res(G_);
+    for (auto& r : res) r.mem_bytes_per_edge = mem_bytes_per_edge();
+
+    // Interleaved bitsets for all graphs
+    Words edge_alive(words_e * G_, ~0ULL);
+    if (words_e > 0 && (N & 63ULL) != 0ULL) {
+        const uint64_t mask = (1ULL << (N & 63ULL)) - 1ULL;
+        for (size_t g = 0; g < G_; ++g) edge_alive[(words_e - 1) * G_ + g] &= mask;
+    }
+    Words new_edge_alive(words_e * G_, 0ULL);
+    Words seen(words_e * G_, 0ULL), nonleaf(words_e * G_, 0ULL);
+    std::vector<uint32_t> live(words_e);
+    for (size_t w = 0; w < words_e; ++w) live[w] = static_cast<uint32_t>(w);
+
+    // A graph is peeled next to the lockstep bitsets and its own extracted edge mask, as in
+    // LeanSolver once its survivors fit the memcap
+    const double budget = memcap_bpe_ * static_cast<double>(N);
+    const size_t held = memory_usage_bytes() + SummaryBitset::memory_bytes(N);
+    auto peel_fits = [&](uint64_t edges) {
+        return static_cast<double>(held + peel_memory_bytes(edges)) <= budget;
+    };
+
+    // Leaves the lockstep: peel unless trimming converged, drop components that can't hold a
+    // k-cycle, then recover
+    SummaryBitset single;
+    auto finish = [&](size_t g, bool converged) {
+        LeanResult& r = res[g];
+        extract_graph(edge_alive, live, g, single);
+        Params pg = p_;
+        pg.key = SipHashKey{ k0_[g], k1_[g] };
+        const EdgeSource src(pg);
+        if (!converged && r.alive_edges > 0 && peel_fits(r.alive_edges)) {
+            const PeelStats st = peel_leaves(src, single);
+            r.peeled_edges = st.removed;
+            r.alive_edges = st.remaining;
+            r.mem_bytes_per_edge = std::max(r.mem_bytes_per_edge, static_cast<double>(held + st.bytes) / static_cast<double>(N));
+        }
+        if (r.alive_edges > 0) {
+            const PruneStats st = prune_components(src, single, cycle_length, threads_);
+            r.pruned_edges = st.removed;
+            r.alive_edges = st.remaining;
+        }
+        if (recover_all_cycles_k(src, single, cycle_length, r.solutions, 0, threads_)) {
+            r.success = true;
+            r.solution_edges = r.solutions[0];
+            r.note = "Solution found (batched DSU/BFS recovery" +
+                     (r.solutions.size() > 1 ? ", " + std::to_string(r.solutions.size()) + " cycles" : std::string()) + ").";
+        } else {
+            r.note = "No cycle found in recovery.";
+        }
+    };
+
+    std::vector<uint8_t> active(G_, 1);
+    std::vector<uint64_t> alive(G_, N), kept(G_, 0);
+    size_t n_active = G_;
+    for (uint32_t r = 0; r < max_rounds && n_active > 0; ++r) {
+        trim_side_all(edge_alive, new_edge_alive, seen, nonleaf, active, live, kept, 0);
+        edge_alive.swap(new_edge_alive);
+        trim_side_all(edge_alive, new_edge_alive, seen, nonleaf, active, live, kept, 1);
+        edge_alive.swap(new_edge_alive);
+
+        // A graph is done once a full round removes nothing (no leaves remain on either side) or
+        // its survivors fit the peeler
+        for (size_t g = 0; g < G_; ++g) {
+            if (!active[g]) continue;
+            res[g].rounds_run = r + 1;
+            res[g].alive_edges = kept[g];
+            const bool converged = kept[g] == alive[g] || kept[g] == 0;
+            alive[g] = kept[g];
+            if (!converged && !peel_fits(kept[g])) continue;
+            finish(g, converged);
+            active[g] = 0;
+            --n_active;
+        }
+    }
+    // Graphs still trimming after max_rounds
+    for (size_t g = 0; g < G_; ++g) if (active[g]) finish(g, false);
+    return res;
+}
+
+} // namespace cuckoo_sip
@@ -0,0 +1,73 @@
+#ifndef CUCKOO_SIP_BATCH_LEAN_SOLVER_H
+#define CUCKOO_SIP_BATCH_LEAN_SOLVER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "graph.h"
+#include "lean_solver.h"
+#include "summary_bitset.h"
+
+namespace cuckoo_sip {
+
+// Lockstep lean solver for G graphs that share edge_bits and hash variant but differ in key.
+// Each nonce is hashed under the keys of the graphs where its edge is still alive (lane-parallel
+// SipHash) and every bitmap is stored interleaved (word w of graph g lives at w*G + g), so one
+// fused scan of the live edge words trims all graphs. A graph leaves the lockstep as soon as its
+// survivors fit the worklist peeler within the memcap (or it converges) and is peeled and
+// recovered on its own. Intended for small edge_bits where a single graph underuses the core.
+class BatchLeanSolver {
+public:
+    BatchLeanSolver(const Params& params, const std::vector<SipHashKey>& keys, uint32_t threads,
+                    double memcap_bytes_per_edge = 1.0);
+
+    // Trims all graphs for up to max_rounds (each graph stops once it converges or can be handed
+    // to the peeler), then recovers a k-cycle per graph. Result g corresponds to keys[g].
+    std::vector<LeanResult> solve(uint32_t max_rounds = 256, uint32_t cycle_length = 42);
+
+    // Theoretical persistent memory usage per graph (bitsets and its share of the live word list)
+    size_t memory_usage_bytes() const;
+    double mem_bytes_per_edge() const;
+
+    size_t graphs() const { return G_; }
+
+private:
+    const Params p_;
+    const uint32_t threads_;
+    const double memcap_bpe_;
+    const size_t G_;
+    std::vector<uint64_t> k0_, k1_; // keys in lane (SoA) layout
+
+    using Words = tracked_vector<uint64_t, MemTag::Bitsets>; // interleaved bitsets
+
+    static inline size_t words_for_bits(uint64_t nbits) { return static_cast<size_t>((nbits + 63ULL) / 64ULL); }
+    // Interleaved bitset helpers: bit idx of graph g
+    inline bool bit_get(const Words& v, uint64_t idx, size_t g) const {
+        return (v[(idx >> 6) * G_ + g] >> (idx & 63ULL)) & 1ULL;
+    }
+    inline void bit_set(Words& v, uint64_t idx, size_t g) const {
+        v[(idx >> 6) * G_ + g] |= (1ULL << (idx & 63ULL));
+    }
+
+    // Hash nonce under count gathered keys; out receives masked node ids.
+    void hash_lanes(uint64_t nonce, const uint64_t* k0, const uint64_t* k1, uint64_t* out, size_t count) const;
+
+    // One lockstep side pass over the live words of all active graphs. live lists the words where
+    // an active graph has an alive edge and is compacted to those that keep one; rows of inactive
+    // graphs and words off the list are left stale.
+    void trim_side_all(const Words& edge_alive,
+                       Words& new_edge_alive,
+                       Words& seen,
+                       Words& nonleaf,
+                       const std::vector<uint8_t>& active,
+                       std::vector<uint32_t>& live,
+                       std::vector<uint64_t>& kept,
+                       int side) const;
+
+    // Copy graph g's edge mask out of the interleaved layout (live words only).
+    void extract_graph(const Words& interleaved, const std::vector<uint32_t>& live, size_t g, SummaryBitset& out) const;
+};
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_BATCH_LEAN_SOLVER_H
@@ -0,0 +1,185 @@
+#include "components.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "mem_track.h"
+
+namespace cuckoo_sip {
+
+namespace {
+
+template <typename T>
+using PruneVec = tracked_vector<T, MemTag::Recovery>;
+
+// Below this many alive edges one thread does everything
+constexpr uint64_t kMinParallelEdges = 1ULL << 14;
+
+// f(t) for every t < T, each on its own thread (counted by pw) when T > 1
+template <class F>
+void parallel(uint32_t T, PerfWorkers& pw, F&& f) {
+    if (T == 1) { f(0U); return; }
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < T; ++t) workers.emplace_back([&pw, &f, t]() { pw.run(t, [&]() { f(t); }); });
+    for (auto& w : workers) w.join();
+}
+
+inline uint32_t load(const uint32_t& x) { return __atomic_load_n(&x, __ATOMIC_RELAXED); }
+inline bool cas(uint32_t& x, uint32_t expected, uint32_t desired) {
+    return __atomic_compare_exchange_n(&x, &expected, desired, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+// Root of x with path halving; safe against concurrent unite()
+uint32_t find(PruneVec<uint32_t>& parent, uint32_t x) {
+    for (;;) {
+        const uint32_t p = load(parent[x]);
+        if (p == x) return x;
+        const uint32_t gp = load(parent[p]);
+        if (gp != p) cas(parent[x], p, gp);
+        x = gp;
+    }
+}
+
+// Link the larger root under the smaller; parents only ever decrease, so no cycles form
+void unite(PruneVec<uint32_t>& parent, uint32_t a, uint32_t b) {
+    for (;;) {
+        a = find(parent, a);
+        b = find(parent, b);
+        if (a == b) return;
+        if (a < b) std::swap(a, b);
+        if (cas(parent[a], a, b)) return;
+    }
+}
+
+} // namespace
+
+size_t prune_memory_bytes(uint64_t alive_edges) {
+    // endpoints (8) + the larger of sorting (keys and merge buffer, 16) and components (parent,
+    // edge and node counts per node, at most two nodes per edge: 24)
+    return static_cast<size_t>(alive_edges) * (8 + 24) + 256;
+}
+
+PruneStats prune_components(const EdgeSource& src, SummaryBitset& edge_alive, uint32_t k, uint32_t threads,
+                            PerfReport* perf) {
+    PruneStats st;
+    const size_t W = edge_alive.word_count();
+    const uint64_t total = edge_alive.count();
+    if (total == 0) return st;
+    const uint32_t T = total < kMinParallelEdges ? 1U : std::max(1U, static_cast<uint32_t>(std::min<size_t>(threads, W)));
+    PerfWorkers pw(T > 1 ? perf : nullptr, Phase::Peel, T);
+
+    // Thread t owns bitmap words [wb[t], wb[t+1]), holding alive edges [eb[t], eb[t+1]) in index order
+    std::vector<size_t> wb(T + 1), eb(T + 1, 0);
+    for (uint32_t t = 0; t <= T; ++t) wb[t] = W * t / T;
+    parallel(T, pw, [&](uint32_t t) {
+        size_t c = 0;
+        edge_alive.for_each_word_in(wb[t], wb[t + 1], [&](size_t, uint64_t m) { c += static_cast<size_t>(__builtin_popcountll(m)); });
+        eb[t + 1] = c;
+    });
+    for (uint32_t t = 0; t < T; ++t) eb[t + 1] += eb[t];
+    const size_t M = eb[T];
+
+    // Raw endpoints, replaced by dense ids as each side is relabelled
+    PruneVec<uint32_t> node_of[2];
+    node_of[0].resize(M);
+    node_of[1].resize(M);
+    parallel(T, pw, [&](uint32_t t) {
+        size_t j = eb[t];
+        edge_alive.for_each_word_in(wb[t], wb[t + 1], [&](size_t w, uint64_t m) {
+            node_t us[64], vs[64];
+            src.word_endpoints(w, m, us, vs);
+            for (; m; m &= m - 1, ++j) {
+                const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(m));
+                node_of[0][j] = us[b];
+                node_of[1][j] = vs[b];
+            }
+        });
+    });
+
+    // Per side: sort (node << 32 | edge) in T chunks merged pairwise, then number distinct nodes
+    // chunk by chunk from a prefix sum; side 1 ids follow side 0's
+    std::vector<size_t> kb(T + 1);
+    for (uint32_t t = 0; t <= T; ++t) kb[t] = M * t / T;
+    uint32_t nodes = 0;
+    {
+        PruneVec<uint64_t> keys(M), tmp(M);
+        std::vector<uint32_t> fresh(T + 1, 0);
+        for (int side = 0; side < 2; ++side) {
+            PruneVec<uint32_t>& nd = node_of[side];
+            parallel(T, pw, [&](uint32_t t) {
+                for (size_t j = kb[t]; j < kb[t + 1]; ++j) keys[j] = (static_cast<uint64_t>(nd[j]) << 32) | j;
+                std::sort(keys.begin() + kb[t], keys.begin() + kb[t + 1]);
+            });
+            for (uint32_t width = 1; width < T; width *= 2) {
+                parallel((T + 2 * width - 1) / (2 * width), pw, [&](uint32_t g) {
+                    const uint32_t c0 = g * 2 * width;
+                    const size_t lo = kb[c0], mid = kb[std::min(T, c0 + width)], hi = kb[std::min(T, c0 + 2 * width)];
+                    std::merge(keys.begin() + lo, keys.begin() + mid, keys.begin() + mid, keys.begin() + hi, tmp.begin() + lo);
+                });
+                keys.swap(tmp);
+            }
+            auto starts_node = [&](size_t j) { return j == 0 || (keys[j] >> 32) != (keys[j - 1] >> 32); };
+            parallel(T, pw, [&](uint32_t t) {
+                uint32_t c = 0;
+                for (size_t j = kb[t]; j < kb[t + 1]; ++j) c += starts_node(j);
+                fresh[t + 1] = c;
+            });
+            fresh[0] = nodes;
+            for (uint32_t t = 0; t < T; ++t) fresh[t + 1] += fresh[t];
+            parallel(T, pw, [&](uint32_t t) {
+                uint32_t id = fresh[t];
+                for (size_t j = kb[t]; j < kb[t + 1]; ++j) {
+                    id += starts_node(j);
+                    nd[static_cast<uint32_t>(keys[j])] = id - 1;
+                }
+            });
+            nodes = fresh[T];
+        }
+    }
+
+    // Union the endpoints of every edge, flatten to roots, then count edges and nodes per root
+    std::vector<size_t> nb(T + 1);
+    for (uint32_t t = 0; t <= T; ++t) nb[t] = static_cast<size_t>(nodes) * t / T;
+    PruneVec<uint32_t> parent(nodes), edges_in(nodes, 0), nodes_in(nodes, 0);
+    parallel(T, pw, [&](uint32_t t) {
+        for (size_t n = nb[t]; n < nb[t + 1]; ++n) parent[n] = static_cast<uint32_t>(n);
+    });
+    parallel(T, pw, [&](uint32_t t) {
+        for (size_t j = kb[t]; j < kb[t + 1]; ++j) unite(parent, node_of[0][j], node_of[1][j]);
+    });
+    parallel(T, pw, [&](uint32_t t) {
+        for (size_t n = nb[t]; n < nb[t + 1]; ++n)
+            __atomic_store_n(&parent[n], find(parent, static_cast<uint32_t>(n)), __ATOMIC_RELAXED);
+    });
+    parallel(T, pw, [&](uint32_t t) {
+        for (size_t n = nb[t]; n < nb[t + 1]; ++n) __atomic_fetch_add(&nodes_in[parent[n]], 1U, __ATOMIC_RELAXED);
+        for (size_t j = kb[t]; j < kb[t + 1]; ++j) __atomic_fetch_add(&edges_in[parent[node_of[0][j]]], 1U, __ATOMIC_RELAXED);
+    });
+    st.bytes = M * 2 * sizeof(uint32_t) +
+               std::max(M * 2 * sizeof(uint64_t), static_cast<size_t>(nodes) * 3 * sizeof(uint32_t));
+
+    // A connected component has edges >= nodes - 1, with equality exactly for trees
+    auto keep = [&](uint32_t r) { return edges_in[r] >= k && edges_in[r] >= nodes_in[r]; };
+    for (uint32_t n = 0; n < nodes; ++n)
+        if (parent[n] == n && keep(n)) ++st.components;
+
+    // Threads clear bits only inside their own words
+    std::vector<uint64_t> removed(T, 0);
+    parallel(T, pw, [&](uint32_t t) {
+        size_t j = eb[t];
+        edge_alive.for_each_word_in(wb[t], wb[t + 1], [&](size_t w, uint64_t m) {
+            for (; m; m &= m - 1, ++j) {
+                if (keep(parent[node_of[0][j]])) continue;
+                edge_alive.clear_bit((static_cast<uint64_t>(w) << 6) | static_cast<uint64_t>(__builtin_ctzll(m)));
+                ++removed[t];
+            }
+        });
+    });
+    pw.record();
+    for (uint64_t r : removed) st.removed += r;
+    st.remaining = M - st.removed;
+    return st;
+}
+
+} // namespace cuckoo_sip
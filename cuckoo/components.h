@@ -0,0 +1,33 @@
+#ifndef CUCKOO_SIP_COMPONENTS_H
+#define CUCKOO_SIP_COMPONENTS_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "edge_source.h"
+#include "summary_bitset.h"
+#include "perf_counters.h"
+
+namespace cuckoo_sip {
+
+struct PruneStats {
+    uint64_t removed = 0;      // edges in dropped components
+    uint64_t remaining = 0;    // edges handed to recovery
+    uint64_t components = 0;   // components kept
+    size_t bytes = 0;          // working memory allocated over the call
+};
+
+// Upper bound on prune_components working memory for a given number of alive edges
+size_t prune_memory_bytes(uint64_t alive_edges);
+
+// Connected components of the alive edges on up to threads threads: endpoints are relabelled to
+// dense ids by a chunked parallel sort, then merged with a lock-free union-find (roots link to
+// the smaller id, so the result doesn't depend on scheduling). Clears every edge whose component
+// can't hold a k-cycle: fewer than k edges, or a tree (edges == nodes - 1). Run before recovery.
+// With perf, the worker threads' counters are added to the peel phase.
+PruneStats prune_components(const EdgeSource& src, SummaryBitset& edge_alive, uint32_t k, uint32_t threads,
+                            PerfReport* perf = nullptr);
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_COMPONENTS_H
@@ -0,0 +1,163 @@
+#include "edge_source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mem_track.h"
+
+namespace cuckoo_sip {
+
+namespace {
+
+using EdgeTable = tracked_vector<node_t, MemTag::Edges>;
+
+// Endpoint file: this header, zero padding to kTableOffset, then u[N] and v[N]
+constexpr char kMagic[8] = { 'C', 'S', 'I', 'P', 'E', 'D', 'G', '1' };
+constexpr size_t kTableOffset = 64;
+struct FileHeader {
+    char magic[8];
+    uint32_t edge_bits;
+    uint32_t family;
+    uint32_t variant;
+    uint32_t node_bytes;
+    uint64_t k0;
+    uint64_t k1;
+};
+static_assert(sizeof(FileHeader) <= kTableOffset, "endpoint file header overflows its slot");
+
+FileHeader header_for(const Params& p) {
+    FileHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.edge_bits = p.edge_bits;
+    h.family = static_cast<uint32_t>(p.family);
+    h.variant = static_cast<uint32_t>(p.variant);
+    h.node_bytes = sizeof(node_t);
+    h.k0 = p.key.k0;
+    h.k1 = p.key.k1;
+    return h;
+}
+
+size_t file_bytes(const Params& p) { return kTableOffset + 2 * static_cast<size_t>(p.N) * sizeof(node_t); }
+
+// Endpoints of edges [w0 * 64, w1 * 64) ∩ [0, N) into u / v (indexed from w0 * 64)
+void hash_words(const Params& p, uint64_t w0, uint64_t w1, node_t* u, node_t* v) {
+    for (uint64_t w = w0; w < w1; ++w) {
+        const uint64_t left = p.N - (w << 6);
+        const uint64_t mask = left >= 64 ? ~0ULL : ((1ULL << left) - 1ULL);
+        word_endpoints(p, w, mask, u + ((w - w0) << 6), v + ((w - w0) << 6));
+    }
+}
+
+// Map path read-only if it holds p's graph; null otherwise
+std::shared_ptr<const void> try_map(const Params& p, const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st{};
+    const size_t bytes = file_bytes(p);
+    void* addr = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == bytes)
+        addr = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return nullptr;
+    const FileHeader want = header_for(p);
+    if (std::memcmp(addr, &want, sizeof(want)) != 0) {
+        ::munmap(addr, bytes);
+        return nullptr;
+    }
+    return std::shared_ptr<const void>(addr, [bytes](const void* a) { ::munmap(const_cast<void*>(a), bytes); });
+}
+
+} // namespace
+
+const char* edge_source_name(EdgeSourceKind kind) {
+    switch (kind) {
+        case EdgeSourceKind::Hash: return "hash";
+        case EdgeSourceKind::Memory: return "ram";
+        case EdgeSourceKind::Mapped: return "mmap";
+    }
+    return "?";
+}
+
+EdgeSource EdgeSource::in_memory(const Params& p) {
+    // Both sides are whole words long; the last word's padding stays zero
+    const uint64_t words = (p.N + 63) / 64;
+    auto table = std::make_shared<EdgeTable>(static_cast<size_t>(words) * 128);
+    node_t* u = table->data();
+    node_t* v = u + words * 64;
+    hash_words(p, 0, words, u, v);
+
+    EdgeSource src(p);
+    src.kind_ = EdgeSourceKind::Memory;
+    src.u_ = u;
+    src.v_ = v;
+    src.table_ = table;
+    return src;
+}
+
+EdgeSource EdgeSource::mapped(const Params& p, const std::string& path, bool* written) {
+    std::shared_ptr<const void> map = try_map(p, path);
+    if (written) *written = !map;
+    if (!map) {
+        write_endpoint_file(p, path);
+        map = try_map(p, path);
+        if (!map) throw std::runtime_error("Cannot map endpoint file: " + path);
+    }
+    EdgeSource src(p);
+    src.kind_ = EdgeSourceKind::Mapped;
+    src.u_ = reinterpret_cast<const node_t*>(static_cast<const char*>(map.get()) + kTableOffset);
+    src.v_ = src.u_ + p.N;
+    src.table_ = std::move(map);
+    return src;
+}
+
+void write_endpoint_file(const Params& p, const std::string& path) {
+    const std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) throw std::runtime_error("Cannot write endpoint file: " + tmp + ": " + std::strerror(errno));
+
+    bool ok = true;
+    char head[kTableOffset] = {};
+    const FileHeader h = header_for(p);
+    std::memcpy(head, &h, sizeof(h));
+    ok = std::fwrite(head, 1, sizeof(head), f) == sizeof(head);
+
+    // u then v, hashed in chunks of whole words; each chunk's v goes straight to its offset
+    constexpr uint64_t kChunkWords = 1024;
+    const uint64_t words = (p.N + 63) / 64;
+    std::vector<node_t> u(kChunkWords * 64), v(kChunkWords * 64);
+    for (uint64_t w0 = 0; ok && w0 < words; w0 += kChunkWords) {
+        const uint64_t w1 = std::min(words, w0 + kChunkWords);
+        hash_words(p, w0, w1, u.data(), v.data());
+        const size_t n = static_cast<size_t>(std::min(p.N, w1 << 6) - (w0 << 6));
+        const long at = static_cast<long>(kTableOffset + (w0 << 6) * sizeof(node_t));
+        ok = std::fseek(f, at, SEEK_SET) == 0 && std::fwrite(u.data(), sizeof(node_t), n, f) == n &&
+             std::fseek(f, at + static_cast<long>(p.N * sizeof(node_t)), SEEK_SET) == 0 &&
+             std::fwrite(v.data(), sizeof(node_t), n, f) == n;
+    }
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Cannot write endpoint file: " + path);
+    }
+}
+
+std::string endpoint_file_path(const std::string& dir, const Params& p) {
+    std::ostringstream oss;
+    oss << (dir.empty() ? "." : dir) << "/edges_" << p.edge_bits << "_" << graph_family_name(p.family) << "_"
+        << (p.variant == SipHashVariant::SipHash12 ? "sip12" : "sip24") << "_" << std::hex << std::setfill('0')
+        << std::setw(16) << p.key.k0 << std::setw(16) << p.key.k1 << ".bin";
+    return oss.str();
+}
+
+} // namespace cuckoo_sip
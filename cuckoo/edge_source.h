@@ -0,0 +1,86 @@
+#ifndef CUCKOO_SIP_EDGE_SOURCE_H
+#define CUCKOO_SIP_EDGE_SOURCE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "graph.h"
+
+namespace cuckoo_sip {
+
+enum class EdgeSourceKind { Hash, Memory, Mapped };
+
+const char* edge_source_name(EdgeSourceKind kind);
+
+// Where solvers get endpoints from. Hash computes them on the fly (graph.h); Memory precomputes
+// every endpoint into RAM (8 bytes/edge); Mapped maps an endpoint file generated once per key.
+// The two table backends share one lookup kernel, so trimming can be timed apart from hashing
+// and a graph reused across runs. Copies share the table. Solutions are still verified against
+// the hash (verify.h), never the table.
+class EdgeSource {
+public:
+    // On-the-fly hashing
+    explicit EdgeSource(const Params& p) : p_(p) {}
+
+    // Hash every endpoint once into RAM
+    static EdgeSource in_memory(const Params& p);
+
+    // Map the endpoint file at path, writing it first if missing or made for another graph
+    // (*written says which, when given). The mapping outlives an unlink of path, so a caller that
+    // doesn't keep the file can remove it at once. Throws std::runtime_error if the file can't be
+    // written or mapped.
+    static EdgeSource mapped(const Params& p, const std::string& path, bool* written = nullptr);
+
+    const Params& params() const { return p_; }
+    EdgeSourceKind kind() const { return kind_; }
+
+    // Same contract as graph.h word_endpoints: u[b] / v[b] for every set bit b of mask
+    inline void word_endpoints(uint64_t w, uint64_t mask, node_t* u, node_t* v) const {
+        if (kind_ == EdgeSourceKind::Hash) {
+            cuckoo_sip::word_endpoints(p_, w, mask, u, v);
+            return;
+        }
+        const node_t* tu = u_ + (w << 6);
+        const node_t* tv = v_ + (w << 6);
+        while (mask) {
+            const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(mask));
+            mask &= mask - 1;
+            if (u) u[b] = tu[b];
+            if (v) v[b] = tv[b];
+        }
+    }
+
+    inline void word_endpoints(uint64_t w, uint64_t mask, int side, node_t* out) const {
+        word_endpoints(w, mask, side ? nullptr : out, side ? out : nullptr);
+    }
+
+    inline node_t endpoint(uint64_t i, int side) const {
+        if (kind_ == EdgeSourceKind::Hash) return cuckoo_sip::endpoint(p_, i, side);
+        return side ? v_[i] : u_[i];
+    }
+
+private:
+    Params p_;
+    EdgeSourceKind kind_ = EdgeSourceKind::Hash;
+    const node_t* u_ = nullptr; // N side-0 endpoints, then
+    const node_t* v_ = nullptr; // N side-1 endpoints (table backends)
+    std::shared_ptr<const void> table_; // owns the RAM table or the mapping
+};
+
+// Same key, size, hash and family: endpoints agree
+inline bool same_graph(const Params& a, const Params& b) {
+    return a.edge_bits == b.edge_bits && a.key.k0 == b.key.k0 && a.key.k1 == b.key.k1 &&
+           a.variant == b.variant && a.family == b.family;
+}
+
+// Write every endpoint of p's graph to path: a header naming the graph, then u[N] and v[N].
+void write_endpoint_file(const Params& p, const std::string& path);
+
+// Default file for p's graph in dir: edges_<edge_bits>_<family>_<variant>_<key hex>.bin
+std::string endpoint_file_path(const std::string& dir, const Params& p);
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_EDGE_SOURCE_H
@@ -10,12 +10,22 @@ namespace cuckoo_sip {
 
 using node_t = uint32_t; // supports up to 2^32 nodes per side
 
+// How edge endpoints are derived from the key.
+// PerEdge: endpoint(i, side) = SipHash((i << 1) | side), one independent hash per endpoint.
+// Block64 (Cuckaroo-style): edges 64b..64b+63 share one chained SipHash block; edge i's u/v are the
+// low/high 32 bits of its block output. One step yields both endpoints, but any endpoint needs
+// its whole block, so scans hash per 64-edge bitmap word (word_endpoints) rather than per edge.
+enum class GraphFamily { PerEdge, Block64 };
+
+inline const char* graph_family_name(GraphFamily f) { return f == GraphFamily::Block64 ? "block64" : "sip"; }
+
 struct Params {
     uint32_t edge_bits = 29;           // n: N = 2^n edges
     uint64_t N = 1ULL << 29;           // edges
     uint64_t node_mask = (1ULL << 29) - 1ULL; // mask for nodes
     SipHashKey key{};                  // SipHash key
     SipHashVariant variant = SipHashVariant::SipHash12; // hash variant
+    GraphFamily family = GraphFamily::PerEdge;
 };
 
 inline void set_edge_bits(Params& p, uint32_t edge_bits) {
@@ -29,13 +39,58 @@ inline uint64_t hash_nonce(const Params& p, uint64_t nonce) {
     else return siphash24(p.key, nonce);
 }
 
+// Block64: the kSipBlock outputs of block b (edges b*64 ..)
+inline void hash_block(const Params& p, uint64_t block, uint64_t* out) {
+    if (p.variant == SipHashVariant::SipHash12) siphash12_block(p.key, block * kSipBlock, out);
+    else siphash24_block(p.key, block * kSipBlock, out);
+}
+
+inline node_t block_endpoint(const Params& p, uint64_t h, int side) {
+    return static_cast<node_t>((side ? (h >> 32) : h) & p.node_mask);
+}
+
 inline node_t endpoint(const Params& p, uint64_t i, int side) {
+    if (p.family == GraphFamily::Block64) {
+        uint64_t buf[kSipBlock];
+        hash_block(p, i / kSipBlock, buf);
+        return block_endpoint(p, buf[i % kSipBlock], side);
+    }
     // side = 0 => u, side = 1 => v
     const uint64_t x = (i << 1) | (static_cast<uint64_t>(side) & 1ULL);
     const uint64_t h = hash_nonce(p, x);
     return static_cast<node_t>(h & p.node_mask);
 }
 
+static_assert(kSipBlock == 64, "Block64 blocks must coincide with 64-bit bitmap words");
+
+// Endpoints of the edges in bitmap word w (edges 64w .. 64w+63) selected by mask: u[b] / v[b] for
+// every set bit b; a null u or v skips that side. Block64 hashes the word's block once.
+inline void word_endpoints(const Params& p, uint64_t w, uint64_t mask, node_t* u, node_t* v) {
+    if (p.family == GraphFamily::Block64) {
+        uint64_t buf[kSipBlock];
+        hash_block(p, w, buf);
+        while (mask) {
+            const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(mask));
+            mask &= mask - 1;
+            if (u) u[b] = block_endpoint(p, buf[b], 0);
+            if (v) v[b] = block_endpoint(p, buf[b], 1);
+        }
+        return;
+    }
+    while (mask) {
+        const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(mask));
+        mask &= mask - 1;
+        const uint64_t i = (w << 6) | b;
+        if (u) u[b] = endpoint(p, i, 0);
+        if (v) v[b] = endpoint(p, i, 1);
+    }
+}
+
+// One side only
+inline void word_endpoints(const Params& p, uint64_t w, uint64_t mask, int side, node_t* out) {
+    word_endpoints(p, w, mask, side ? nullptr : out, side ? out : nullptr);
+}
+
 } // namespace cuckoo_sip
 
 #endif // CUCKOO_SIP_GRAPH_H
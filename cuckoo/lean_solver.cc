@@ -1,15 +1,50 @@
 #include "lean_solver.h"
 
 #include <algorithm>
-#include <limits>
-#include <unordered_map>
+#include <memory>
 #include <stdexcept>
-#include <deque>
+
+#include "recovery.h"
+#include "peeler.h"
+#include "components.h"
 
 namespace cuckoo_sip {
 
+namespace {
+
+// Calls f(i, u, v) for every alive edge in index order; sides picks the endpoints computed (0: u,
+// 1: v, 2: both; the other is passed as 0). With depth > 0 edges pass through a window of depth
+// in flight: pre(u, v) issues an edge's bitmap prefetches as it enters and f runs as it leaves,
+// so up to depth misses overlap instead of each hash stalling on its own (group prefetching:
+// AMAC for a state machine with a single memory access per edge).
+template <class Pre, class F>
+void scan_alive(const EdgeSource& src, const SummaryBitset& edge_alive, int sides, uint32_t depth, Pre&& pre, F&& f) {
+    struct Slot { uint64_t i; node_t u, v; };
+    Slot win[LeanSolver::kMaxPrefetch];
+    uint32_t pos = 0;
+    bool full = false;
+    edge_alive.for_each_word([&](size_t w, uint64_t m) {
+        node_t us[64], vs[64];
+        src.word_endpoints(w, m, sides != 1 ? us : nullptr, sides != 0 ? vs : nullptr);
+        for (; m; m &= m - 1) {
+            const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(m));
+            const Slot e{ (static_cast<uint64_t>(w) << 6) | b, sides != 1 ? us[b] : 0, sides != 0 ? vs[b] : 0 };
+            if (depth == 0) { f(e.i, e.u, e.v); continue; }
+            pre(e.u, e.v);
+            if (full) f(win[pos].i, win[pos].u, win[pos].v);
+            win[pos] = e;
+            if (++pos == depth) { pos = 0; full = true; }
+        }
+    });
+    if (full)
+        for (uint32_t j = pos; j < depth; ++j) f(win[j].i, win[j].u, win[j].v);
+    for (uint32_t j = 0; j < pos; ++j) f(win[j].i, win[j].u, win[j].v);
+}
+
+} // namespace
+
 LeanSolver::LeanSolver(const Params& params, uint32_t threads, double memcap_bytes_per_edge)
-    : p_(params), threads_(threads), memcap_bpe_(memcap_bytes_per_edge) {
+    : p_(params), threads_(threads), memcap_bpe_(memcap_bytes_per_edge), src_(params) {
     // Enforce memory cap (persistent bitsets only)
     if (mem_bytes_per_edge() > memcap_bpe_) {
         throw std::runtime_error("Lean solver theoretical mem exceeds cap: " +
@@ -17,13 +52,15 @@ LeanSolver::LeanSolver(const Params& params, uint32_t threads, double memcap_byt
     }
 }
 
+void LeanSolver::set_edge_source(const EdgeSource& src) {
+    if (!same_graph(src.params(), p_)) throw std::runtime_error("Edge source is for another graph");
+    src_ = src;
+}
+
 size_t LeanSolver::memory_usage_bytes() const {
-    const uint64_t N = p_.N;
-    const size_t words = words_for_bits(N);
     // Persistent bitsets: edge_alive (N bits), new_edge_alive (N bits),
-    // seen0, nonleaf0, seen1, nonleaf1 (each N bits)
-    const size_t bytes = (2 + 4) * words * sizeof(uint64_t);
-    return bytes;
+    // seen0, nonleaf0, seen1, nonleaf1 (each N bits), each with a 1/64 summary level
+    return (2 + 4) * SummaryBitset::memory_bytes(p_.N);
 }
 
 double LeanSolver::mem_bytes_per_edge() const {
@@ -31,239 +68,322 @@ double LeanSolver::mem_bytes_per_edge() const {
     return static_cast<double>(memory_usage_bytes()) / static_cast<double>(p_.N);
 }
 
-void LeanSolver::init_edge_alive(std::vector<uint64_t>& edge_alive) const {
-    const uint64_t N = p_.N;
-    const size_t words = words_for_bits(N);
-    edge_alive.assign(words, ~0ULL);
-    // Mask off extra bits in last word
-    if (words > 0) {
-        const uint64_t valid = N & 63ULL;
-        if (valid != 0ULL) {
-            const uint64_t mask = ((1ULL << valid) - 1ULL);
-            edge_alive.back() &= mask;
-        }
-    }
+void LeanSolver::init_edge_alive(SummaryBitset& edge_alive) const {
+    edge_alive.reset(p_.N);
+    edge_alive.set_all();
 }
 
-uint64_t LeanSolver::trim_round_both(const std::vector<uint64_t>& edge_alive,
-                                      std::vector<uint64_t>& new_edge_alive,
-                                      std::vector<uint64_t>& seen0,
-                                      std::vector<uint64_t>& nonleaf0,
-                                      std::vector<uint64_t>& seen1,
-                                      std::vector<uint64_t>& nonleaf1) const {
-    const uint64_t N = p_.N;
-
-    // Reset bitmaps
-    std::fill(seen0.begin(), seen0.end(), 0ULL);
-    std::fill(nonleaf0.begin(), nonleaf0.end(), 0ULL);
-    std::fill(seen1.begin(), seen1.end(), 0ULL);
-    std::fill(nonleaf1.begin(), nonleaf1.end(), 0ULL);
+uint64_t LeanSolver::trim_round_both(const SummaryBitset& edge_alive,
+                                      SummaryBitset& new_edge_alive,
+                                      SummaryBitset& seen0,
+                                      SummaryBitset& nonleaf0,
+                                      SummaryBitset& seen1,
+                                      SummaryBitset& nonleaf1) const {
+    // Reset bitmaps (only words touched by the previous pass)
+    seen0.clear(); nonleaf0.clear();
+    seen1.clear(); nonleaf1.clear();
 
     // Pass 1: build seen and nonleaf bitmaps for both sides
-    for (uint64_t i = 0; i < N; ++i) {
-        if (!bit_get(edge_alive, i)) continue;
-        const node_t u = endpoint(p_, i, 0);
-        const node_t v = endpoint(p_, i, 1);
-        if (!bit_get(seen0, u)) bit_set(seen0, u); else bit_set(nonleaf0, u);
-        if (!bit_get(seen1, v)) bit_set(seen1, v); else bit_set(nonleaf1, v);
+    {
+        PerfScope ps(perf_, counters_, Phase::Count);
+        MemScope ms(mem_, Phase::Count);
+        scan_alive(src_, edge_alive, 2, prefetch_,
+                   [&](node_t u, node_t v) {
+                       seen0.prefetch(u, true); nonleaf0.prefetch(u, true);
+                       seen1.prefetch(v, true); nonleaf1.prefetch(v, true);
+                   },
+                   [&](uint64_t, node_t u, node_t v) {
+                       if (!seen0.get(u)) seen0.set(u); else nonleaf0.set(u);
+                       if (!seen1.get(v)) seen1.set(v); else nonleaf1.set(v);
+                   });
     }
 
     // Pass 2: keep edges with both endpoints in nonleaf
-    std::fill(new_edge_alive.begin(), new_edge_alive.end(), 0ULL);
+    PerfScope ps(perf_, counters_, Phase::Filter);
+    MemScope ms(mem_, Phase::Filter);
+    new_edge_alive.clear();
     uint64_t kept = 0;
-    for (uint64_t i = 0; i < N; ++i) {
-        if (!bit_get(edge_alive, i)) continue;
-        const node_t u = endpoint(p_, i, 0);
-        const node_t v = endpoint(p_, i, 1);
-        if (bit_get(nonleaf0, u) && bit_get(nonleaf1, v)) {
-            bit_set(new_edge_alive, i);
-            ++kept;
-        }
-    }
+    scan_alive(src_, edge_alive, 2, prefetch_,
+               [&](node_t u, node_t v) { nonleaf0.prefetch(u); nonleaf1.prefetch(v); },
+               [&](uint64_t i, node_t u, node_t v) {
+                   if (nonleaf0.get(u) && nonleaf1.get(v)) {
+                       new_edge_alive.set(i);
+                       ++kept;
+                   }
+               });
     return kept;
 }
 
-uint64_t LeanSolver::trim_round_side(const std::vector<uint64_t>& edge_alive,
-                                     std::vector<uint64_t>& new_edge_alive,
-                                     std::vector<uint64_t>& seen_side,
-                                     std::vector<uint64_t>& nonleaf_side,
-                                     int side) const {
-    const uint64_t N = p_.N;
-
-    std::fill(seen_side.begin(), seen_side.end(), 0ULL);
-    std::fill(nonleaf_side.begin(), nonleaf_side.end(), 0ULL);
+void LeanSolver::count_side(const SummaryBitset& edge_alive, SummaryBitset& seen_side, SummaryBitset& nonleaf_side,
+                            int side) const {
+    seen_side.clear();
+    nonleaf_side.clear();
+    auto node = [side](node_t u, node_t v) { return side ? v : u; };
 
     // Build seen/nonleaf for the chosen side only
-    for (uint64_t i = 0; i < N; ++i) {
-        if (!bit_get(edge_alive, i)) continue;
-        const node_t x = endpoint(p_, i, side);
-        if (!bit_get(seen_side, x)) bit_set(seen_side, x); else bit_set(nonleaf_side, x);
-    }
+    PerfScope ps(perf_, counters_, Phase::Count);
+    MemScope ms(mem_, Phase::Count);
+    scan_alive(src_, edge_alive, side, prefetch_,
+               [&](node_t u, node_t v) {
+                   seen_side.prefetch(node(u, v), true);
+                   nonleaf_side.prefetch(node(u, v), true);
+               },
+               [&](uint64_t, node_t u, node_t v) {
+                   const node_t x = node(u, v);
+                   if (!seen_side.get(x)) seen_side.set(x); else nonleaf_side.set(x);
+               });
+}
+
+uint64_t LeanSolver::trim_round_side(const SummaryBitset& edge_alive,
+                                     SummaryBitset& new_edge_alive,
+                                     SummaryBitset& seen_side,
+                                     SummaryBitset& nonleaf_side,
+                                     int side) const {
+    count_side(edge_alive, seen_side, nonleaf_side, side);
+    auto node = [side](node_t u, node_t v) { return side ? v : u; };
 
     // Keep edges whose chosen endpoint is nonleaf
-    std::fill(new_edge_alive.begin(), new_edge_alive.end(), 0ULL);
+    PerfScope ps(perf_, counters_, Phase::Filter);
+    MemScope ms(mem_, Phase::Filter);
+    new_edge_alive.clear();
     uint64_t kept = 0;
-    for (uint64_t i = 0; i < N; ++i) {
-        if (!bit_get(edge_alive, i)) continue;
-        const node_t x = endpoint(p_, i, side);
-        if (bit_get(nonleaf_side, x)) {
-            bit_set(new_edge_alive, i);
-            ++kept;
-        }
-    }
+    scan_alive(src_, edge_alive, side, prefetch_,
+               [&](node_t u, node_t v) { nonleaf_side.prefetch(node(u, v)); },
+               [&](uint64_t i, node_t u, node_t v) {
+                   if (nonleaf_side.get(node(u, v))) {
+                       new_edge_alive.set(i);
+                       ++kept;
+                   }
+               });
     return kept;
 }
 
-// Sparse DSU + adjacency BFS recovery on the trimmed subgraph for cycle length k.
-bool LeanSolver::recover_cycle_k(const std::vector<uint64_t>& edge_alive, uint32_t k, std::vector<uint64_t>& solution) const {
-    if (k < 2) return false;
-    const uint64_t N = p_.N;
-    struct Edge { node_t u; node_t v; uint64_t idx; };
-    std::vector<Edge> edges; edges.reserve(1024);
-    for (uint64_t i = 0; i < N; ++i) {
-        if (!bit_get(edge_alive, i)) continue;
-        edges.push_back(Edge{ endpoint(p_, i, 0), endpoint(p_, i, 1), i });
-    }
-    if (edges.size() < k) return false;
+uint64_t LeanSolver::filter_count_side(const SummaryBitset& edge_alive,
+                                       SummaryBitset& new_edge_alive,
+                                       const SummaryBitset& nonleaf_side,
+                                       SummaryBitset& seen_next,
+                                       SummaryBitset& nonleaf_next,
+                                       int side) const {
+    seen_next.clear();
+    nonleaf_next.clear();
+    new_edge_alive.clear();
+    PerfScope ps(perf_, counters_, Phase::Filter);
+    MemScope ms(mem_, Phase::Filter);
 
-    auto pack = [](int side, node_t n) -> uint64_t {
-        return (static_cast<uint64_t>(side & 1) << 32) | static_cast<uint64_t>(n);
-    };
-
-    struct DSU {
-        std::unordered_map<uint64_t, uint64_t> p;
-        std::unordered_map<uint64_t, uint32_t> sz;
-        uint64_t find(uint64_t x) {
-            auto it = p.find(x);
-            if (it == p.end()) { p[x] = x; sz[x] = 1; return x; }
-            if (it->second == x) return x;
-            uint64_t r = find(it->second);
-            p[x] = r;
-            return r;
-        }
-        bool unite(uint64_t a, uint64_t b) {
-            a = find(a); b = find(b);
-            if (a == b) return false;
-            uint32_t sa = sz[a], sb = sz[b];
-            if (sa < sb) { std::swap(a, b); std::swap(sa, sb); }
-            p[b] = a;
-            sz[a] = sa + sb;
-            return true;
-        }
-    } dsu;
-
-    // adjacency forest for edges that joined components so far
-    std::unordered_map<uint64_t, std::vector<std::pair<uint64_t, uint64_t>>> adj;
-    adj.reserve(edges.size() * 2 + 1);
-
-    auto bfs_path_edges = [&](uint64_t src, uint64_t dst, std::vector<uint64_t>& path_out) -> bool {
-        std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> prev; // node -> (parent, edge_idx)
-        std::deque<uint64_t> dq;
-        dq.push_back(src);
-        prev[src] = { std::numeric_limits<uint64_t>::max(), 0ULL };
-        bool found = false;
-        while (!dq.empty()) {
-            uint64_t x = dq.front(); dq.pop_front();
-            if (x == dst) { found = true; break; }
-            auto it = adj.find(x);
-            if (it == adj.end()) continue;
-            for (const auto& pr : it->second) {
-                uint64_t y = pr.first; uint64_t eidx = pr.second;
-                if (prev.find(y) == prev.end()) {
-                    prev[y] = { x, eidx };
-                    dq.push_back(y);
-                }
-            }
-        }
-        if (!found) return false;
-        // reconstruct edge list from dst back to src
-        path_out.clear();
-        uint64_t cur = dst;
-        while (true) {
-            auto it = prev.find(cur);
-            if (it == prev.end()) return false;
-            if (it->second.first == std::numeric_limits<uint64_t>::max()) break;
-            path_out.push_back(it->second.second);
-            cur = it->second.first;
+    // A Block64 block or a table row yields both endpoints for the price of one; hashing per edge,
+    // the other side is computed for survivors only. Survival is decided a word at a time, so
+    // prefetching is per word (its alive edges, then its survivors) rather than a sliding window.
+    const bool both = p_.family == GraphFamily::Block64 || src_.kind() != EdgeSourceKind::Hash;
+    uint64_t kept = 0;
+    edge_alive.for_each_word([&](size_t w, uint64_t m) {
+        node_t xs[64], ys[64];
+        if (both) src_.word_endpoints(w, m, side ? ys : xs, side ? xs : ys);
+        else src_.word_endpoints(w, m, side, xs);
+        if (prefetch_)
+            for (uint64_t mm = m; mm; mm &= mm - 1) nonleaf_side.prefetch(xs[__builtin_ctzll(mm)]);
+        uint64_t keep = 0;
+        for (uint64_t mm = m; mm; mm &= mm - 1) {
+            const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(mm));
+            if (nonleaf_side.get(xs[b])) keep |= 1ULL << b;
         }
-        std::reverse(path_out.begin(), path_out.end());
-        return true;
-    };
+        if (keep == 0) return;
+        new_edge_alive.or_word(w, keep);
+        kept += static_cast<uint64_t>(__builtin_popcountll(keep));
 
-    // Iterate edges; when an edge links nodes already connected, extract the unique path and test length k-1.
-    for (const auto& e : edges) {
-        const uint64_t a = pack(0, e.u);
-        const uint64_t b = pack(1, e.v);
-        const uint64_t ra = dsu.find(a);
-        const uint64_t rb = dsu.find(b);
-        if (ra == rb) {
-            std::vector<uint64_t> path;
-            if (bfs_path_edges(a, b, path)) {
-                if (path.size() + 1 == k) {
-                    solution = path;
-                    solution.push_back(e.idx);
-                    return true;
-                }
+        if (!both) src_.word_endpoints(w, keep, side ^ 1, ys);
+        if (prefetch_)
+            for (uint64_t mm = keep; mm; mm &= mm - 1) {
+                const node_t y = ys[__builtin_ctzll(mm)];
+                seen_next.prefetch(y, true);
+                nonleaf_next.prefetch(y, true);
             }
-        } else {
-            dsu.unite(ra, rb);
-            adj[a].push_back({ b, e.idx });
-            adj[b].push_back({ a, e.idx });
+        for (uint64_t mm = keep; mm; mm &= mm - 1) {
+            const node_t y = ys[__builtin_ctzll(mm)];
+            if (!seen_next.get(y)) seen_next.set(y); else nonleaf_next.set(y);
         }
-    }
+    });
+    return kept;
+}
 
-    return false;
+// Enumerate all k-cycles on the trimmed subgraph.
+size_t LeanSolver::recover_cycles_k(const SummaryBitset& edge_alive, uint32_t k, std::vector<std::vector<uint64_t>>& solutions) const {
+    return recover_all_cycles_k(src_, edge_alive, k, solutions, 0, recovery_threads(), perf_);
 }
 
 LeanResult LeanSolver::solve(uint32_t max_rounds, uint32_t cycle_length) {
-    const uint64_t N = p_.N;
     LeanResult res;
     res.mem_bytes_per_edge = mem_bytes_per_edge();
 
+    std::unique_ptr<PerfCounters> counters;
+    if (perf_enabled_) {
+        counters.reset(new PerfCounters());
+        res.perf.enabled = true;
+        res.perf.available = counters->available();
+        res.perf.error = counters->error();
+        perf_ = &res.perf;
+        counters_ = counters.get();
+    }
+    if (mem_enabled_) {
+        res.mem.begin();
+        mem_ = &res.mem;
+    }
+
+    SummaryBitset edge_alive;
+    trim_into(edge_alive, max_rounds, cycle_length, res);
+    recover(edge_alive, cycle_length, res);
+
+    if (mem_) res.mem.end();
+    perf_ = nullptr;
+    counters_ = nullptr;
+    mem_ = nullptr;
+    return res;
+}
+
+LeanResult LeanSolver::trim(SummaryBitset& edge_alive, uint32_t max_rounds, uint32_t cycle_length) const {
+    LeanResult res;
+    res.mem_bytes_per_edge = mem_bytes_per_edge();
+    trim_into(edge_alive, max_rounds, cycle_length, res);
+    return res;
+}
+
+void LeanSolver::trim_into(SummaryBitset& edge_alive, uint32_t max_rounds, uint32_t cycle_length, LeanResult& res) const {
+    const uint64_t N = p_.N;
+
     // Allocate bitsets
-    const size_t words_e = words_for_bits(N);
-    std::vector<uint64_t> edge_alive; init_edge_alive(edge_alive);
-    std::vector<uint64_t> new_edge_alive(words_e, 0ULL);
-    std::vector<uint64_t> seen0(words_e, 0ULL), nonleaf0(words_e, 0ULL);
-    std::vector<uint64_t> seen1(words_e, 0ULL), nonleaf1(words_e, 0ULL);
+    SummaryBitset new_edge_alive, seen0, nonleaf0, seen1, nonleaf1;
+    {
+        PerfScope ps(perf_, counters_, Phase::Seeding);
+        MemScope ms(mem_, Phase::Seeding);
+        init_edge_alive(edge_alive);
+        new_edge_alive.reset(N);
+        seen0.reset(N); nonleaf0.reset(N);
+        seen1.reset(N); nonleaf1.reset(N);
+    }
+
+    // The peeler runs next to the two edge bitsets once the degree bitsets are released, recovery
+    // next to edge_alive alone
+    const double budget = memcap_bpe_ * static_cast<double>(N);
+    const size_t edge_bitsets = 2 * SummaryBitset::memory_bytes(N);
+    auto peel_fits = [&](uint64_t edges) {
+        return static_cast<double>(edge_bitsets + peel_memory_bytes(edges)) <= budget;
+    };
 
     uint64_t alive = N;
-    for (uint32_t r = 0; r < max_rounds; ++r) {
+    bool converged = false;
+    bool primed = false; // fused: seen0 / nonleaf0 hold the counts of edge_alive
+    // One round; returns false once nothing changes
+    auto trim_round = [&]() {
         // Alternate-side trimming within each round for better convergence
-        uint64_t kept0 = trim_round_side(edge_alive, new_edge_alive, seen0, nonleaf0, 0);
-        edge_alive.swap(new_edge_alive);
-        uint64_t kept1 = trim_round_side(edge_alive, new_edge_alive, seen1, nonleaf1, 1);
-        edge_alive.swap(new_edge_alive);
+        uint64_t kept1 = 0;
+        if (fused_) {
+            if (!primed) count_side(edge_alive, seen0, nonleaf0, 0);
+            primed = true;
+            filter_count_side(edge_alive, new_edge_alive, nonleaf0, seen1, nonleaf1, 0);
+            edge_alive.swap(new_edge_alive);
+            kept1 = filter_count_side(edge_alive, new_edge_alive, nonleaf1, seen0, nonleaf0, 1);
+            edge_alive.swap(new_edge_alive);
+        } else {
+            trim_round_side(edge_alive, new_edge_alive, seen0, nonleaf0, 0);
+            edge_alive.swap(new_edge_alive);
+            kept1 = trim_round_side(edge_alive, new_edge_alive, seen1, nonleaf1, 1);
+            edge_alive.swap(new_edge_alive);
+        }
 
-        res.rounds_run = r + 1;
+        ++res.rounds_run;
         res.alive_edges = kept1;
 
+        // Neither side dropped an edge, so no node on either side is a leaf and the combined
+        // check can't remove anything; fused skips it to keep its primed counts
+        if (kept1 == alive && fused_) {
+            converged = true;
+            return false;
+        }
         if (kept1 == alive) {
             // As a final check, do combined trimming to remove any remaining leaves on both sides simultaneously
             uint64_t kept2 = trim_round_both(edge_alive, new_edge_alive, seen0, nonleaf0, seen1, nonleaf1);
             edge_alive.swap(new_edge_alive);
             res.alive_edges = kept2;
-            if (kept2 == alive) break;
+            if (kept2 == alive) { converged = true; return false; }
             alive = kept2;
         } else {
             alive = kept1;
         }
+        // Pages of the edge bitsets that the survivors have left go back to the OS
+        edge_alive.release_empty();
+        new_edge_alive.release_empty();
+        if (mem_) mem_->record_round();
+        return alive > 0;
+    };
 
-        if (alive == 0) break;
+    for (uint32_t r = 0; r < max_rounds && !peel_fits(alive); ++r) {
+        if (!trim_round()) break;
     }
+    // Bounded recovery: past max_rounds, keep trimming while neither the peeler nor recovery fits
+    while (bounded_recovery_ && !converged && alive > 0 && !peel_fits(alive) &&
+           static_cast<double>(recovery_footprint(alive, cycle_length)) > budget) {
+        if (!trim_round()) break;
+    }
+
+    SummaryBitset().swap(seen0); SummaryBitset().swap(nonleaf0);
+    SummaryBitset().swap(seen1); SummaryBitset().swap(nonleaf1);
+    if (!converged && alive > 0 && peel_fits(alive)) {
+        PerfScope ps(perf_, counters_, Phase::Peel);
+        MemScope ms(mem_, Phase::Peel);
+        const PeelStats st = peel_leaves(src_, edge_alive);
+        res.peeled_edges = st.removed;
+        res.alive_edges = st.remaining;
+        alive = st.remaining;
+        res.mem_bytes_per_edge = std::max(res.mem_bytes_per_edge,
+                                          static_cast<double>(edge_bitsets + st.bytes) / static_cast<double>(N));
+    }
+    SummaryBitset().swap(new_edge_alive);
 
-    // Try to recover a k-cycle from remaining subgraph
-    std::vector<uint64_t> solution;
-    if (recover_cycle_k(edge_alive, cycle_length, solution)) {
+    // Drop components that can't hold a k-cycle. The pass needs less than recovery, so only
+    // bounded recovery has to check it against the memcap.
+    const size_t prune_bytes = SummaryBitset::memory_bytes(N) + prune_memory_bytes(alive);
+    if (alive > 0 && (!bounded_recovery_ || static_cast<double>(prune_bytes) <= budget)) {
+        PerfScope ps(perf_, counters_, Phase::Peel);
+        MemScope ms(mem_, Phase::Peel);
+        const PruneStats st = prune_components(src_, edge_alive, cycle_length, threads_, perf_);
+        res.pruned_edges = st.removed;
+        alive = st.remaining;
+        res.mem_bytes_per_edge = std::max(res.mem_bytes_per_edge, static_cast<double>(SummaryBitset::memory_bytes(N) + st.bytes) /
+                                                                      static_cast<double>(N));
+    }
+    res.alive_edges = alive;
+    edge_alive.release_empty();
+    trim_heap();
+}
+
+size_t LeanSolver::recovery_footprint(uint64_t alive_edges, uint32_t cycle_length) const {
+    return SummaryBitset::memory_bytes(p_.N) + recovery_memory_bytes(alive_edges, cycle_length, recovery_threads());
+}
+
+void LeanSolver::recover(const SummaryBitset& edge_alive, uint32_t cycle_length, LeanResult& res) const {
+    const uint64_t N = p_.N;
+    const double budget = memcap_bpe_ * static_cast<double>(N);
+    const uint64_t alive = res.alive_edges;
+
+    // Try to recover a k-cycle from remaining subgraph (bounded: only within the memcap)
+    const size_t rec_bytes = recovery_footprint(alive, cycle_length);
+    if (bounded_recovery_ && static_cast<double>(rec_bytes) > budget) {
+        res.note = "Recovery of " + std::to_string(alive) + " edges needs " +
+                   std::to_string(static_cast<double>(rec_bytes) / static_cast<double>(N)) +
+                   " bytes/edge over memcap; skipped.";
+    } else {
+        res.mem_bytes_per_edge = std::max(res.mem_bytes_per_edge, static_cast<double>(rec_bytes) / static_cast<double>(N));
+        PerfScope ps(perf_, counters_, Phase::Recovery);
+        MemScope ms(mem_, Phase::Recovery);
+        recover_cycles_k(edge_alive, cycle_length, res.solutions);
+    }
+    if (!res.solutions.empty()) {
         res.success = true;
-        res.solution_edges = std::move(solution);
-        res.note = "Solution found (DSU/BFS recovery).";
+        res.solution_edges = res.solutions[0];
+        res.note = "Solution found (DSU/BFS recovery" + (res.solutions.size() > 1 ? ", " + std::to_string(res.solutions.size()) + " cycles" : std::string()) + ").";
     } else {
         res.success = false;
-        res.note = "No cycle found in recovery.";
+        if (res.note.empty()) res.note = "No cycle found in recovery.";
     }
-
-    return res;
 }
 
 } // namespace cuckoo_sip
@@ -6,15 +6,24 @@
 #include <string>
 
 #include "graph.h"
+#include "edge_source.h"
+#include "summary_bitset.h"
+#include "perf_counters.h"
+#include "mem_track.h"
 
 namespace cuckoo_sip {
 
 struct LeanResult {
     bool success = false;
-    std::vector<uint64_t> solution_edges; // k edge indices if success
+    std::vector<uint64_t> solution_edges; // k edge indices if success (the first of solutions)
+    std::vector<std::vector<uint64_t>> solutions; // every distinct k-cycle in the trimmed graph
     size_t rounds_run = 0;
     size_t alive_edges = 0;
-    double mem_bytes_per_edge = 0.0; // computed persistent memory usage
+    uint64_t peeled_edges = 0;       // removed by the worklist peeler after trimming handed over
+    uint64_t pruned_edges = 0;       // in components too small or acyclic for a k-cycle, dropped before recovery
+    double mem_bytes_per_edge = 0.0; // computed persistent memory usage (or peel / recovery bound, if larger)
+    PerfReport perf;                 // per-phase hardware counters when enabled
+    MemReport mem;                   // tracked bytes per structure and RSS per phase when enabled
     std::string note;
 };
 
@@ -22,50 +31,108 @@ class LeanSolver {
 public:
     LeanSolver(const Params& params, uint32_t threads, double memcap_bytes_per_edge = 1.0);
 
-    // Attempts to find a cycle of given length. Returns LeanResult with status and info.
+    // Attempts to find a cycle of given length. Returns LeanResult with status and info. Trimming
+    // rounds run until the survivors fit the worklist peeler within the memcap (or max_rounds),
+    // then the peeler removes the remaining leaves and components that can't hold a k-cycle are
+    // dropped (components.h). Recovery runs next to edge_alive alone and its bound
+    // (recovery_memory_bytes) is included in mem_bytes_per_edge.
     LeanResult solve(uint32_t max_rounds = 256, uint32_t cycle_length = 42);
 
-    // Theoretical persistent memory usage (bitsets)
+    // solve() in two phases, for drivers that overlap one graph's recovery with the next graph's
+    // trimming: trim() leaves the survivors in edge_alive (all other trimming state is freed),
+    // recover() enumerates cycles on them and completes res. Neither collects perf or memory
+    // reports. recover() may run on another thread once trim() has returned.
+    LeanResult trim(SummaryBitset& edge_alive, uint32_t max_rounds = 256, uint32_t cycle_length = 42) const;
+    void recover(const SummaryBitset& edge_alive, uint32_t cycle_length, LeanResult& res) const;
+
+    // Theoretical persistent memory usage (bitsets, including their summary levels)
     size_t memory_usage_bytes() const;
     double mem_bytes_per_edge() const;
 
+    // Capture per-phase hardware counters into LeanResult::perf (off by default)
+    void set_perf(bool enabled) { perf_enabled_ = enabled; }
+
+    // Collect LeanResult::mem (off by default): measured bytes of the bitsets, peeler and
+    // recovery structures plus peak RSS per phase, next to the theoretical mem_bytes_per_edge.
+    void set_mem_report(bool enabled) { mem_enabled_ = enabled; }
+
+    // Hold the memcap end to end (off by default): recovery runs only when its bound fits next to
+    // edge_alive. Past max_rounds trimming continues until it does; a converged graph that still
+    // doesn't fit (small N, where the 2-core outweighs the cap) is reported, not recovered.
+    void set_bounded_recovery(bool enabled) { bounded_recovery_ = enabled; }
+
+    // Read endpoints from src (precomputed RAM or mapped table) instead of hashing; throws if src
+    // is for another graph. Solutions are still verified against the hash.
+    void set_edge_source(const EdgeSource& src);
+
+    // Group prefetch (0 = off): trimming keeps up to depth edges in flight, prefetching each
+    // edge's bitmap words as it is hashed and touching them depth edges later, so the random
+    // bitmap misses overlap. Capped at kMaxPrefetch.
+    static constexpr uint32_t kMaxPrefetch = 256;
+    void set_prefetch(uint32_t depth) { prefetch_ = depth < kMaxPrefetch ? depth : kMaxPrefetch; }
+
+    // Fused side passes (off by default): one scan filters on the previous count and counts the
+    // survivors' other endpoints for the next pass, so a side pass scans edge_alive once instead
+    // of twice and the other endpoint is hashed only for survivors (Block64 and table sources read
+    // both in one go). Only the first pass needs a count scan of its own. Same survivors and rounds.
+    void set_fused(bool enabled) { fused_ = enabled; }
+
+    // Threads for recovery (0 = threads, the default); lets a driver that overlaps recovery with
+    // the next graph's trimming split the threads between them. Scales the recovery bound.
+    void set_recovery_threads(uint32_t threads) { recovery_threads_ = threads; }
+
 private:
     const Params p_;
     const uint32_t threads_;
     const double memcap_bpe_;
-
-    // Bitset helpers
-    static inline size_t words_for_bits(uint64_t nbits) { return static_cast<size_t>((nbits + 63ULL) / 64ULL); }
-    static inline bool bit_get(const std::vector<uint64_t>& v, uint64_t idx) {
-        return (v[idx >> 6] >> (idx & 63ULL)) & 1ULL;
-    }
-    static inline void bit_set(std::vector<uint64_t>& v, uint64_t idx) {
-        v[idx >> 6] |= (1ULL << (idx & 63ULL));
-    }
-    static inline void bit_clear(std::vector<uint64_t>& v, uint64_t idx) {
-        v[idx >> 6] &= ~(1ULL << (idx & 63ULL));
-    }
+    EdgeSource src_;
+    bool perf_enabled_ = false;
+    // Set for the duration of solve() when counters are enabled
+    PerfReport* perf_ = nullptr;
+    PerfCounters* counters_ = nullptr;
+    bool mem_enabled_ = false;
+    MemReport* mem_ = nullptr;
+    bool bounded_recovery_ = false;
+    uint32_t prefetch_ = 0;
+    bool fused_ = false;
+    uint32_t recovery_threads_ = 0;
+    uint32_t recovery_threads() const { return recovery_threads_ ? recovery_threads_ : threads_; }
 
     // Allocate and initialize masks
-    void init_edge_alive(std::vector<uint64_t>& edge_alive) const;
+    void init_edge_alive(SummaryBitset& edge_alive) const;
 
     // One trimming iteration computing nonleaf sets for both sides and filtering edges with both endpoints nonleaf.
-    uint64_t trim_round_both(const std::vector<uint64_t>& edge_alive,
-                             std::vector<uint64_t>& new_edge_alive,
-                             std::vector<uint64_t>& seen0,
-                             std::vector<uint64_t>& nonleaf0,
-                             std::vector<uint64_t>& seen1,
-                             std::vector<uint64_t>& nonleaf1) const;
+    uint64_t trim_round_both(const SummaryBitset& edge_alive,
+                             SummaryBitset& new_edge_alive,
+                             SummaryBitset& seen0,
+                             SummaryBitset& nonleaf0,
+                             SummaryBitset& seen1,
+                             SummaryBitset& nonleaf1) const;
 
     // Alternate-side leaf trimming: trim on a single side (0 or 1), keeping edges whose endpoint on that side is nonleaf.
-    uint64_t trim_round_side(const std::vector<uint64_t>& edge_alive,
-                             std::vector<uint64_t>& new_edge_alive,
-                             std::vector<uint64_t>& seen_side,
-                             std::vector<uint64_t>& nonleaf_side,
+    uint64_t trim_round_side(const SummaryBitset& edge_alive,
+                             SummaryBitset& new_edge_alive,
+                             SummaryBitset& seen_side,
+                             SummaryBitset& nonleaf_side,
                              int side) const;
 
-    // Attempt cycle recovery for a target cycle length k using DSU+BFS on the forest of remaining edges.
-    bool recover_cycle_k(const std::vector<uint64_t>& edge_alive, uint32_t k, std::vector<uint64_t>& solution) const;
+    // Fused pass: keep edges whose endpoint on side is in nonleaf_side and count the survivors'
+    // endpoints on the other side into seen_next / nonleaf_next. count_side primes the first pass.
+    void count_side(const SummaryBitset& edge_alive, SummaryBitset& seen_side, SummaryBitset& nonleaf_side, int side) const;
+    uint64_t filter_count_side(const SummaryBitset& edge_alive,
+                               SummaryBitset& new_edge_alive,
+                               const SummaryBitset& nonleaf_side,
+                               SummaryBitset& seen_next,
+                               SummaryBitset& nonleaf_next,
+                               int side) const;
+
+    // Seeding, trimming, peeling and component pruning of solve(); sets res.alive_edges
+    void trim_into(SummaryBitset& edge_alive, uint32_t max_rounds, uint32_t cycle_length, LeanResult& res) const;
+    // edge_alive plus the recovery bound
+    size_t recovery_footprint(uint64_t alive_edges, uint32_t cycle_length) const;
+
+    // Enumerate every k-cycle among the remaining edges; returns the number found.
+    size_t recover_cycles_k(const SummaryBitset& edge_alive, uint32_t k, std::vector<std::vector<uint64_t>>& solutions) const;
 };
 
 } // namespace cuckoo_sip
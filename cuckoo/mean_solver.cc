@@ -1,201 +1,674 @@
 #include "mean_solver.h"
 
-#include <unordered_map>
-#include <deque>
 #include <algorithm>
-#include <limits>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "recovery.h"
+#include "peeler.h"
+#include "components.h"
+#include "spsc_ring.h"
+#include "util.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace cuckoo_sip {
 
-MeanSolver::MeanSolver(const Params& params, uint32_t threads, uint32_t bucket_bits)
-    : p_(params), threads_(threads), bucket_bits_(bucket_bits) {}
+namespace {
 
-void MeanSolver::init_edge_alive(std::vector<uint64_t>& edge_alive) const {
-    const uint64_t N = p_.N;
-    const size_t words = words_for_bits(N);
-    edge_alive.assign(words, ~0ULL);
-    if (words > 0) {
-        const uint64_t valid = N & 63ULL;
-        if (valid != 0ULL) {
-            const uint64_t mask = ((1ULL << valid) - 1ULL);
-            edge_alive.back() &= mask;
-        }
+// Unit of hand-off between a hasher and a scatter thread
+constexpr uint32_t kPipeBatch = 256;
+constexpr size_t kPipeSlots = 8;
+struct EdgeBatch {
+    uint32_t n = 0;
+    uint64_t idx[kPipeBatch];
+    node_t node[kPipeBatch];
+};
+
+// Buckets are split by the second radix level only when each sub-bucket gets this many entries
+// on average; smaller ones are counted whole
+constexpr uint64_t kFineMinPerSub = 16;
+
+// Bytes held by the H x S rings of one pipelined scatter
+inline size_t pipeline_ring_bytes(uint32_t h, uint32_t s) {
+    return static_cast<size_t>(h) * s * kPipeSlots * sizeof(EdgeBatch);
+}
+
+// Non-temporal scatter: every bucket fills a cache-line staging slot and whole lines are streamed
+// to the (line-aligned) bucket slice, so the destination is never read for ownership.
+constexpr size_t kLineBytes = 64;
+
+inline void stream_line(void* dst, const void* src) {
+#if defined(__SSE2__)
+    const __m128i* s = static_cast<const __m128i*>(src);
+    __m128i* d = static_cast<__m128i*>(dst);
+    _mm_stream_si128(d + 0, _mm_load_si128(s + 0));
+    _mm_stream_si128(d + 1, _mm_load_si128(s + 1));
+    _mm_stream_si128(d + 2, _mm_load_si128(s + 2));
+    _mm_stream_si128(d + 3, _mm_load_si128(s + 3));
+#else
+    std::memcpy(dst, src, kLineBytes);
+#endif
+}
+
+// Streaming stores are weakly ordered: fence before other threads read the buckets
+inline void stream_fence() {
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
+
+// Entries for the bucket slices of store; cursors are absolute indices and every bucket slice
+// starts base + a multiple of L, where store + base is line aligned.
+template <typename Entry>
+struct LineStager {
+    static constexpr uint64_t L = kLineBytes / sizeof(Entry);
+    Entry* store;
+    Entry* lines; // B staging lines, line aligned
+    uint64_t base;
+
+    inline void put(uint64_t& cursor, uint64_t b, Entry e) const {
+        const uint64_t c = cursor++;
+        const uint64_t k = (c - base) & (L - 1);
+        Entry* line = lines + b * L;
+        line[k] = e;
+        if (k == L - 1) stream_line(store + c - k, line);
+    }
+
+    // Partial last line of bucket b (regular stores)
+    inline void drain(uint64_t cursor, uint64_t b) const {
+        const uint64_t k = (cursor - base) & (L - 1);
+        if (k) std::memcpy(store + cursor - k, lines + b * L, k * sizeof(Entry));
     }
+};
+
+// First element of v at a line boundary
+template <typename Entry, typename V>
+inline uint64_t line_offset(const V& v) {
+    const uintptr_t a = reinterpret_cast<uintptr_t>(v.data());
+    return ((kLineBytes - a % kLineBytes) % kLineBytes) / sizeof(Entry);
 }
 
-uint64_t MeanSolver::trim_side_bucketed(const std::vector<uint64_t>& edge_alive, std::vector<uint64_t>& new_edge_alive, int side) const {
-    const uint64_t N = p_.N;
-    const uint64_t bucket_count = (bucket_bits_ >= 32 ? (1ULL << 32) : (1ULL << bucket_bits_));
-    const uint64_t bucket_mask = (bucket_bits_ >= 64 ? ~0ULL : ((1ULL << bucket_bits_) - 1ULL));
+} // namespace
 
-    // Initialize new edge mask to zeros
-    std::fill(new_edge_alive.begin(), new_edge_alive.end(), 0ULL);
+MeanSolver::MeanSolver(const Params& params, uint32_t threads, uint32_t bucket_bits, double memcap_bytes_per_edge)
+    : p_(params), threads_(threads), memcap_bpe_(memcap_bytes_per_edge), src_(params), requested_bucket_bits_(bucket_bits) {
+    choose_layout(bucket_bits);
+}
 
-    // Allocate buckets of edge indices
-    std::vector<std::vector<uint64_t>> buckets;
-    buckets.resize(bucket_count);
-    // Heuristic reserve to reduce reallocations on small N
-    const uint64_t approx_per_bucket = (N / (bucket_count ? bucket_count : 1ULL)) + 1ULL;
-    for (auto& b : buckets) b.reserve(static_cast<size_t>(approx_per_bucket));
+void MeanSolver::set_pipeline(uint32_t hash_threads, uint32_t scatter_threads) {
+    hash_threads_ = hash_threads;
+    scatter_threads_ = scatter_threads;
+    choose_layout(requested_bucket_bits_);
+}
+
+void MeanSolver::set_edge_source(const EdgeSource& src) {
+    if (!same_graph(src.params(), p_)) throw std::runtime_error("Edge source is for another graph");
+    src_ = src;
+}
+
+void MeanSolver::set_nt_stores(bool enabled) {
+    nt_stores_ = enabled;
+    choose_layout(requested_bucket_bits_);
+}
+
+void MeanSolver::set_fine_bucket_bits(uint32_t fine_bits) {
+    fine_bits_ = fine_bits;
+    choose_layout(requested_bucket_bits_);
+}
 
-    // Partition alive edges into buckets by low bits of the chosen side's endpoint
-    for (uint64_t i = 0; i < N; ++i) {
-        if (!bit_get(edge_alive, i)) continue;
-        const node_t x = endpoint(p_, i, side);
-        const uint64_t b = static_cast<uint64_t>(x) & bucket_mask;
-        buckets[static_cast<size_t>(b)].push_back(i);
+void MeanSolver::set_fused(bool enabled) {
+    fused_ = enabled;
+    choose_layout(requested_bucket_bits_);
+}
+
+size_t MeanSolver::estimate_bytes(uint32_t bucket_bits, uint32_t pass_bits, uint32_t entry_bytes) const {
+    const uint64_t N = p_.N;
+    const uint64_t B = 1ULL << bucket_bits, P = 1ULL << pass_bits;
+    const uint32_t eb = p_.edge_bits;
+    const uint32_t rb = eb > bucket_bits + pass_bits ? eb - bucket_bits - pass_bits : 0;
+    // First round: every edge is alive; the largest node range holds about N/P entries (+4 sigma).
+    const double per_range = static_cast<double>(N) / static_cast<double>(P);
+    const size_t entries = static_cast<size_t>(per_range + 4.0 * std::sqrt(per_range)) + 1;
+    size_t bytes = 2 * SummaryBitset::memory_bytes(N);                    // edge_alive, new_edge_alive
+    bytes += (P * B + B) * sizeof(uint64_t);                              // histogram + cursors
+    bytes += entries * entry_bytes;                                       // bucket entries
+    bytes += 2 * words_for_bits(1ULL << rb) * sizeof(uint64_t);           // seen/nonleaf per bucket
+    if (hash_threads_ && scatter_threads_) {
+        bytes += hash_threads_ * P * B * sizeof(uint64_t);                // per-hasher histograms
+        bytes += pipeline_ring_bytes(hash_threads_, scatter_threads_);    // hand-off rings
+    }
+    if (nt_stores_) bytes += (2 * B + 2) * kLineBytes;                    // staging lines + slice padding
+    if (fused_ && !(hash_threads_ && scatter_threads_)) bytes += P * B * sizeof(uint64_t); // next side's histogram
+    if (std::min(fine_bits_, rb) > 0) {
+        const double per_bucket = per_range / static_cast<double>(B);
+        bytes += (static_cast<size_t>(per_bucket + 4.0 * std::sqrt(per_bucket)) + 1) * entry_bytes; // split buffer
+        bytes += ((1ULL << std::min(fine_bits_, rb)) + 1) * sizeof(uint64_t);                      // sub-bucket offsets
     }
+    return bytes;
+}
 
-    uint64_t kept = 0;
-    // For each bucket, count degrees per node and keep edges whose node degree >= 2 on this side.
-    for (size_t b = 0; b < buckets.size(); ++b) {
-        auto& vec = buckets[b];
-        if (vec.empty()) continue;
-        std::unordered_map<node_t, uint32_t> deg;
-        deg.reserve(vec.size() * 2 + 1);
-        for (uint64_t idx : vec) {
-            const node_t x = endpoint(p_, idx, side);
-            auto it = deg.find(x);
-            if (it == deg.end()) deg.emplace(x, 1U); else ++(it->second);
+void MeanSolver::choose_layout(uint32_t requested_bucket_bits) {
+    const uint32_t eb = p_.edge_bits;
+    auto width_for = [&](uint32_t bb, uint32_t pb) -> uint32_t {
+        const uint32_t rb = eb > bb + pb ? eb - bb - pb : 0;
+        return (eb + rb <= 32) ? 4U : 8U;
+    };
+
+    if (memcap_bpe_ <= 0.0) {
+        bucket_bits_ = std::min(requested_bucket_bits, eb);
+        pass_bits_ = 0;
+        entry_bytes_ = width_for(bucket_bits_, 0);
+        return;
+    }
+
+    // Fewest passes first (each extra pass rehashes the alive edges). Within a pass count prefer
+    // 4-byte entries, then the bucket_bits closest to the request; fewer bucket bits shrink the
+    // P x B histogram on small graphs, more can make entries fit in 4 bytes.
+    const double budget = memcap_bpe_ * static_cast<double>(p_.N);
+    size_t best = 0;
+    for (uint32_t pb = 0; pb <= std::min(eb, 10U); ++pb) {
+        const uint32_t lo = std::min(requested_bucket_bits, eb - pb);
+        const uint32_t hi = std::min(eb - pb, lo + 4);
+        int pick = -1;
+        uint32_t pick_w = 0, pick_dist = 0;
+        for (uint32_t bb = (lo > 8 ? lo - 8 : 0); bb <= hi; ++bb) {
+            const uint32_t w = width_for(bb, pb);
+            const size_t est = estimate_bytes(bb, pb, w);
+            if (best == 0 || est < best) best = est;
+            if (static_cast<double>(est) > budget) continue;
+            const uint32_t dist = bb > lo ? bb - lo : lo - bb;
+            if (pick < 0 || w < pick_w || (w == pick_w && dist < pick_dist)) {
+                pick = static_cast<int>(bb); pick_w = w; pick_dist = dist;
+            }
         }
-        for (uint64_t idx : vec) {
-            const node_t x = endpoint(p_, idx, side);
-            if (deg[x] >= 2U) { bit_set(new_edge_alive, idx); ++kept; }
+        if (pick >= 0) {
+            bucket_bits_ = static_cast<uint32_t>(pick);
+            pass_bits_ = pb;
+            entry_bytes_ = pick_w;
+            return;
         }
-        // Free memory held by this bucket and its degree map before next bucket
-        std::vector<uint64_t>().swap(vec);
-        deg.clear();
     }
+    throw std::runtime_error("Mean solver cannot fit memcap: best layout needs " +
+                             std::to_string(static_cast<double>(best) / static_cast<double>(p_.N)) + ">" +
+                             std::to_string(memcap_bpe_) + " bytes/edge");
+}
 
-    return kept;
+size_t MeanSolver::memory_usage_bytes() const {
+    return estimate_bytes(bucket_bits_, pass_bits_, entry_bytes_);
 }
 
-// Sparse DSU + adjacency BFS recovery on the trimmed subgraph for cycle length k.
-bool MeanSolver::recover_cycle_k(const std::vector<uint64_t>& edge_alive, uint32_t k, std::vector<uint64_t>& solution) const {
-    if (k < 2) return false;
+double MeanSolver::mem_bytes_per_edge() const {
+    if (p_.N == 0) return 0.0;
+    return static_cast<double>(memory_usage_bytes()) / static_cast<double>(p_.N);
+}
+
+void MeanSolver::init_edge_alive(SummaryBitset& edge_alive) const {
+    edge_alive.reset(p_.N);
+    edge_alive.set_all();
+}
+
+uint64_t MeanSolver::trim_side_bucketed(const SummaryBitset& edge_alive, SummaryBitset& new_edge_alive,
+                                        int side, Scratch& s) const {
+    if (entry_bytes_ == 4) return trim_side_entries(edge_alive, new_edge_alive, side, s, s.store32, s.stage32, s.fine32);
+    return trim_side_entries(edge_alive, new_edge_alive, side, s, s.store64, s.stage64, s.fine64);
+}
+
+template <typename Entry>
+uint64_t MeanSolver::trim_side_entries(const SummaryBitset& edge_alive, SummaryBitset& new_edge_alive,
+                                       int side, Scratch& s, BucketVec<Entry>& store, BucketVec<Entry>& stage,
+                                       BucketVec<Entry>& fine) const {
     const uint64_t N = p_.N;
-    struct Edge { node_t u; node_t v; uint64_t idx; };
-    std::vector<Edge> edges; edges.reserve(1024);
-    for (uint64_t i = 0; i < N; ++i) {
-        if (!bit_get(edge_alive, i)) continue;
-        edges.push_back(Edge{ endpoint(p_, i, 0), endpoint(p_, i, 1), i });
-    }
-    if (edges.size() < k) return false;
-
-    auto pack = [](int side, node_t n) -> uint64_t { return (static_cast<uint64_t>(side & 1) << 32) | static_cast<uint64_t>(n); };
-
-    struct DSU {
-        std::unordered_map<uint64_t, uint64_t> p;
-        std::unordered_map<uint64_t, uint32_t> sz;
-        uint64_t find(uint64_t x) {
-            auto it = p.find(x);
-            if (it == p.end()) { p[x] = x; sz[x] = 1; return x; }
-            if (it->second == x) return x;
-            uint64_t r = find(it->second);
-            p[x] = r;
-            return r;
-        }
-        bool unite(uint64_t a, uint64_t b) {
-            a = find(a); b = find(b);
-            if (a == b) return false;
-            uint32_t sa = sz[a], sb = sz[b];
-            if (sa < sb) { std::swap(a, b); std::swap(sa, sb); }
-            p[b] = a;
-            sz[a] = sa + sb;
-            return true;
+    const uint32_t eb = p_.edge_bits;
+    const uint32_t bb = bucket_bits_, rb = residual_bits();
+    const uint64_t B = 1ULL << bb, P = 1ULL << pass_bits_;
+    const uint64_t bucket_mask = B - 1ULL;
+    const uint64_t res_mask = (1ULL << rb) - 1ULL;
+    const uint64_t idx_mask = (1ULL << eb) - 1ULL;
+    const uint32_t range_shift = bb + rb; // x >> range_shift selects the node-range pass
+
+    // Count alive endpoints per (range, bucket) so every bucket gets an exact slice of one flat array.
+    // Fused, the previous scatter already counted them (with the edges it then dropped) into hist_next.
+    const bool pipelined = hash_threads_ > 0 && scatter_threads_ > 0;
+    const bool fused = fused_ && !pipelined;
+    s.cursor.resize(B);
+    if (fused && s.hist_ready) {
+        s.hist.swap(s.hist_next);
+    } else {
+        s.hist.assign(P * B, 0ULL);
+        PerfScope ps(perf_, counters_, Phase::Seeding);
+        MemScope ms(mem_, Phase::Seeding);
+        if (pipelined) {
+            histogram_pipelined(edge_alive, side, s);
+        } else {
+            edge_alive.for_each_word([&](size_t w, uint64_t m) {
+                node_t xs[64];
+                src_.word_endpoints(w, m, side, xs);
+                for (; m; m &= m - 1) {
+                    const uint64_t x = xs[__builtin_ctzll(m)];
+                    ++s.hist[(x >> range_shift) * B + (x & bucket_mask)];
+                }
+            });
         }
-    } dsu;
-
-    // adjacency forest for edges that joined components so far
-    std::unordered_map<uint64_t, std::vector<std::pair<uint64_t, uint64_t>>> adj;
-    adj.reserve(edges.size() * 2 + 1);
-
-    auto bfs_path_edges = [&](uint64_t src, uint64_t dst, std::vector<uint64_t>& path_out) -> bool {
-        std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> prev; // node -> (parent, edge_idx)
-        std::deque<uint64_t> dq;
-        dq.push_back(src);
-        prev[src] = { std::numeric_limits<uint64_t>::max(), 0ULL };
-        bool found = false;
-        while (!dq.empty()) {
-            uint64_t x = dq.front(); dq.pop_front();
-            if (x == dst) { found = true; break; }
-            auto it = adj.find(x);
-            if (it == adj.end()) continue;
-            for (const auto& pr : it->second) {
-                uint64_t y = pr.first; uint64_t eidx = pr.second;
-                if (prev.find(y) == prev.end()) { prev[y] = { x, eidx }; dq.push_back(y); }
+    }
+    if (fused) s.hist_next.assign(P * B, 0ULL);
+
+    s.seen.assign(words_for_bits(1ULL << rb), 0ULL);
+    s.nonleaf.assign(s.seen.size(), 0ULL);
+
+    // Size the entry array once for the largest range (exact allocation, no geometric growth). With
+    // non-temporal stores every bucket slice is rounded up to whole lines, plus one line of slack
+    // to align the array.
+    const uint64_t L = nt_stores_ ? LineStager<Entry>::L : 1;
+    auto slice = [&](uint64_t n) { return (n + L - 1) & ~(L - 1); };
+    uint64_t max_total = 0;
+    for (uint64_t r = 0; r < P; ++r) {
+        uint64_t total = 0;
+        for (uint64_t b = 0; b < B; ++b) total += slice(s.hist[r * B + b]);
+        max_total = std::max(max_total, total);
+    }
+    if (nt_stores_) max_total += L;
+    if (store.size() < max_total) BucketVec<Entry>(static_cast<size_t>(max_total)).swap(store);
+    if (nt_stores_ && stage.size() < (B + 1) * L) BucketVec<Entry>(static_cast<size_t>((B + 1) * L)).swap(stage);
+    // The array keeps its first-round size; the part survivors no longer reach is released
+    if (store.size() > max_total) release_pages(store.data() + max_total, (store.size() - max_total) * sizeof(Entry));
+
+    // Second radix level: buckets with at least kFineMinPerSub entries per sub-bucket on average
+    // are split into a buffer sized for the largest of them
+    const uint32_t fb = fine_bits(), sb = rb - fb;
+    const uint64_t F = 1ULL << fb, sub_mask = (1ULL << sb) - 1ULL;
+    const uint64_t fine_min = fb ? F * kFineMinPerSub : UINT64_MAX;
+    uint64_t max_split = 0;
+    for (uint64_t c = 0; c < P * B; ++c)
+        if (s.hist[c] >= fine_min) max_split = std::max(max_split, s.hist[c]);
+    if (fine.size() < max_split) BucketVec<Entry>(static_cast<size_t>(max_split)).swap(fine);
+    if (max_split) s.fine_hist.resize(F + 1);
+    const uint64_t base = nt_stores_ ? line_offset<Entry>(store) : 0;
+    Entry* lines = nt_stores_ ? stage.data() + line_offset<Entry>(stage) : nullptr;
+
+    size_t bytes = 2 * SummaryBitset::memory_bytes(N) + (s.hist.capacity() + s.hist_next.capacity() + s.cursor.capacity()) * sizeof(uint64_t) +
+                   (store.capacity() + stage.capacity() + fine.capacity()) * sizeof(Entry) + s.fine_hist.capacity() * sizeof(uint64_t) +
+                   (s.seen.capacity() + s.nonleaf.capacity()) * sizeof(uint64_t);
+    if (pipelined) bytes += s.hist_local.capacity() * sizeof(uint64_t) + pipeline_ring_bytes(hash_threads_, scatter_threads_);
+    s.peak_bytes = std::max(s.peak_bytes, bytes);
+
+    // Initialize new edge mask to zeros (only its live words)
+    new_edge_alive.clear();
+
+    // Fused: the first range scanned also histograms the other side of every alive edge
+    bool count_next = fused;
+    auto endpoints = [&](size_t w, uint64_t m, node_t* xs, node_t* ys) {
+        if (count_next) src_.word_endpoints(w, m, side ? ys : xs, side ? xs : ys);
+        else src_.word_endpoints(w, m, side, xs);
+    };
+    auto count_other = [&](uint64_t y) { ++s.hist_next[(y >> range_shift) * B + (y & bucket_mask)]; };
+
+    uint64_t kept = 0;
+    for (uint64_t r = 0; r < P; ++r) {
+        const uint64_t* hist = &s.hist[r * B];
+        uint64_t total = base, entries = 0;
+        for (uint64_t b = 0; b < B; ++b) { s.cursor[b] = total; total += slice(hist[b]); entries += hist[b]; }
+        if (entries == 0) continue;
+
+        // Scatter this range's edges into their buckets: entry = index | residual node bits << edge_bits
+        {
+            PerfScope ps(perf_, counters_, Phase::Seeding);
+            MemScope ms(mem_, Phase::Seeding);
+            const uint64_t t0 = now_ns();
+            if (pipelined) {
+                scatter_pipelined(edge_alive, side, r, s, store, lines, base);
+            } else if (nt_stores_) {
+                const LineStager<Entry> st{ store.data(), lines, base };
+                edge_alive.for_each_word([&](size_t w, uint64_t m) {
+                    node_t xs[64], ys[64];
+                    endpoints(w, m, xs, ys);
+                    for (; m; m &= m - 1) {
+                        const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(m));
+                        const uint64_t x = xs[b];
+                        if (count_next) count_other(ys[b]);
+                        if ((x >> range_shift) != r) continue;
+                        const uint64_t i = (static_cast<uint64_t>(w) << 6) | b;
+                        const uint64_t d = x & bucket_mask;
+                        st.put(s.cursor[d], d, static_cast<Entry>(i | (((x >> bb) & res_mask) << eb)));
+                    }
+                });
+                for (uint64_t d = 0; d < B; ++d) st.drain(s.cursor[d], d);
+                stream_fence();
+            } else {
+                edge_alive.for_each_word([&](size_t w, uint64_t m) {
+                    node_t xs[64], ys[64];
+                    endpoints(w, m, xs, ys);
+                    for (; m; m &= m - 1) {
+                        const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(m));
+                        const uint64_t x = xs[b];
+                        if (count_next) count_other(ys[b]);
+                        if ((x >> range_shift) != r) continue;
+                        const uint64_t i = (static_cast<uint64_t>(w) << 6) | b;
+                        store[s.cursor[x & bucket_mask]++] = static_cast<Entry>(i | (((x >> bb) & res_mask) << eb));
+                    }
+                });
             }
+            s.scatter_ns += now_ns() - t0;
+            count_next = false;
         }
-        if (!found) return false;
-        // reconstruct edge list from dst back to src
-        path_out.clear();
-        uint64_t cur = dst;
-        while (true) {
-            auto it = prev.find(cur);
-            if (it == prev.end()) return false;
-            if (it->second.first == std::numeric_limits<uint64_t>::max()) break;
-            path_out.push_back(it->second.second);
-            cur = it->second.first;
-        }
-        std::reverse(path_out.begin(), path_out.end());
-        return true;
-    };
 
-    for (const auto& e : edges) {
-        const uint64_t a = pack(0, e.u);
-        const uint64_t b = pack(1, e.v);
-        const uint64_t ra = dsu.find(a);
-        const uint64_t rb = dsu.find(b);
-        if (ra == rb) {
-            std::vector<uint64_t> path;
-            if (bfs_path_edges(a, b, path)) {
-                if (path.size() + 1 == k) { solution = path; solution.push_back(e.idx); return true; }
+        // For each bucket, mark nodes seen twice and compact the entries whose node degree >= 2 on
+        // this side to the front of the array (in cache, bucket by bucket).
+        uint64_t out = 0;
+        {
+            PerfScope ps(perf_, counters_, Phase::Count);
+            MemScope ms(mem_, Phase::Count);
+            uint64_t begin = base, written = 0;
+            for (uint64_t b = 0; b < B; begin += slice(hist[b++])) {
+                const uint64_t end = s.cursor[b];
+                written += end - begin;
+                if (end - begin >= fine_min) {
+                    // Counting sort by the top fb residual bits; then each sub-bucket is counted on
+                    // the low sb bits, in the first 2^sb bits of seen/nonleaf
+                    uint64_t* off = s.fine_hist.data();
+                    std::fill(off, off + F + 1, 0ULL);
+                    for (uint64_t j = begin; j < end; ++j) ++off[(static_cast<uint64_t>(store[j]) >> (eb + sb)) + 1];
+                    for (uint64_t f = 1; f <= F; ++f) off[f] += off[f - 1];
+                    for (uint64_t j = begin; j < end; ++j) {
+                        const Entry e = store[j];
+                        fine[off[static_cast<uint64_t>(e) >> (eb + sb)]++] = e;
+                    }
+                    // off[f] now ends sub-bucket f
+                    for (uint64_t f = 0, fbeg = 0; f < F; fbeg = off[f++]) {
+                        const uint64_t fend = off[f];
+                        if (fend - fbeg < 2) continue;
+                        for (uint64_t j = fbeg; j < fend; ++j) {
+                            const uint64_t y = (static_cast<uint64_t>(fine[j]) >> eb) & sub_mask;
+                            if (!bit_get(s.seen, y)) bit_set(s.seen, y); else bit_set(s.nonleaf, y);
+                        }
+                        const uint64_t out0 = out;
+                        for (uint64_t j = fbeg; j < fend; ++j) {
+                            const Entry e = fine[j];
+                            const uint64_t y = (static_cast<uint64_t>(e) >> eb) & sub_mask;
+                            s.seen[y >> 6] = 0ULL;
+                            if (bit_get(s.nonleaf, y)) store[out++] = e;
+                        }
+                        for (uint64_t j = out0; j < out; ++j) s.nonleaf[((static_cast<uint64_t>(store[j]) >> eb) & sub_mask) >> 6] = 0ULL;
+                    }
+                } else if (end - begin >= 2) {
+                    for (uint64_t j = begin; j < end; ++j) {
+                        const uint64_t y = static_cast<uint64_t>(store[j]) >> eb;
+                        if (!bit_get(s.seen, y)) bit_set(s.seen, y); else bit_set(s.nonleaf, y);
+                    }
+                    const uint64_t out0 = out;
+                    for (uint64_t j = begin; j < end; ++j) {
+                        const Entry e = store[j];
+                        const uint64_t y = static_cast<uint64_t>(e) >> eb;
+                        s.seen[y >> 6] = 0ULL;
+                        if (bit_get(s.nonleaf, y)) store[out++] = e;
+                    }
+                    // Every nonleaf node has kept entries, so they cover all touched nonleaf words
+                    for (uint64_t j = out0; j < out; ++j) s.nonleaf[(static_cast<uint64_t>(store[j]) >> eb) >> 6] = 0ULL;
+                }
             }
-        } else {
-            dsu.unite(ra, rb);
-            adj[a].push_back({ b, e.idx });
-            adj[b].push_back({ a, e.idx });
+            s.scatter_bytes += written * sizeof(Entry);
         }
+
+        // Survivors go back into the edge mask (random writes across N bits)
+        PerfScope ps(perf_, counters_, Phase::Filter);
+        MemScope ms(mem_, Phase::Filter);
+        for (uint64_t j = 0; j < out; ++j) new_edge_alive.set(static_cast<uint64_t>(store[j]) & idx_mask);
+        kept += out;
     }
+    s.hist_ready = fused;
+
+    return kept;
+}
 
-    return false;
+void MeanSolver::histogram_pipelined(const SummaryBitset& edge_alive, int side, Scratch& s) const {
+    const uint32_t H = hash_threads_;
+    const uint64_t B = 1ULL << bucket_bits_, P = 1ULL << pass_bits_;
+    const uint64_t bucket_mask = B - 1ULL;
+    const uint32_t range_shift = bucket_bits_ + residual_bits();
+    const size_t cells = static_cast<size_t>(P * B);
+    const size_t W = edge_alive.word_count();
+
+    // Private counts per hasher, summed afterwards (no shared counters)
+    s.hist_local.assign(cells * H, 0ULL);
+    PerfWorkers pw(perf_, Phase::Seeding, H);
+    std::vector<std::thread> hashers;
+    for (uint32_t h = 0; h < H; ++h) {
+        hashers.emplace_back([&, h]() {
+            pw.run(h, [&]() {
+                uint64_t* hist = &s.hist_local[cells * h];
+                edge_alive.for_each_word_in(W * h / H, W * (h + 1) / H, [&](size_t w, uint64_t m) {
+                    node_t xs[64];
+                    src_.word_endpoints(w, m, side, xs);
+                    for (; m; m &= m - 1) {
+                        const uint64_t x = xs[__builtin_ctzll(m)];
+                        ++hist[(x >> range_shift) * B + (x & bucket_mask)];
+                    }
+                });
+            });
+        });
+    }
+    for (auto& t : hashers) t.join();
+    pw.record();
+    for (uint32_t h = 0; h < H; ++h) {
+        const uint64_t* hist = &s.hist_local[cells * h];
+        for (size_t c = 0; c < cells; ++c) s.hist[c] += hist[c];
+    }
+}
+
+template <typename Entry>
+void MeanSolver::scatter_pipelined(const SummaryBitset& edge_alive, int side, uint64_t range,
+                                   Scratch& s, BucketVec<Entry>& store, Entry* lines, uint64_t base) const {
+    const uint32_t eb = p_.edge_bits;
+    const uint32_t bb = bucket_bits_, rb = residual_bits();
+    const uint64_t B = 1ULL << bb;
+    const uint64_t bucket_mask = B - 1ULL;
+    const uint64_t res_mask = (1ULL << rb) - 1ULL;
+    const uint32_t range_shift = bb + rb;
+    const uint32_t H = hash_threads_;
+    const uint32_t S = static_cast<uint32_t>(std::min<uint64_t>(scatter_threads_, B));
+    const size_t W = edge_alive.word_count();
+
+    // rings[h * S + s] carries hasher h's edges for scatter thread s. Scatter thread s owns the
+    // contiguous buckets with (b * S) >> bb == s, so cursors and bucket slices are never shared.
+    using Ring = SpscRing<EdgeBatch, TrackingAllocator<EdgeBatch, MemTag::Buckets>>;
+    std::vector<std::unique_ptr<Ring>> rings;
+    for (size_t q = 0; q < static_cast<size_t>(H) * S; ++q) rings.emplace_back(new Ring(kPipeSlots));
+
+    // Hashers are workers 0..H-1, scatter threads H..H+S-1
+    PerfWorkers pw(perf_, Phase::Seeding, H + S);
+    std::vector<std::thread> workers;
+    for (uint32_t h = 0; h < H; ++h) {
+        workers.emplace_back([&, h]() {
+            pw.run(h, [&]() {
+                std::vector<EdgeBatch*> cur(S, nullptr);
+                auto flush = [&](uint32_t d) {
+                    rings[h * S + d]->publish();
+                    cur[d] = nullptr;
+                };
+                edge_alive.for_each_word_in(W * h / H, W * (h + 1) / H, [&](size_t w, uint64_t m) {
+                    node_t xs[64];
+                    src_.word_endpoints(w, m, side, xs);
+                    for (; m; m &= m - 1) {
+                        const uint32_t bit = static_cast<uint32_t>(__builtin_ctzll(m));
+                        const uint64_t x = xs[bit];
+                        const uint64_t i = (static_cast<uint64_t>(w) << 6) | bit;
+                        if ((x >> range_shift) != range) continue;
+                        const uint32_t d = static_cast<uint32_t>(((x & bucket_mask) * S) >> bb);
+                        EdgeBatch* b = cur[d];
+                        if (!b) { b = cur[d] = rings[h * S + d]->claim_wait(); b->n = 0; }
+                        b->idx[b->n] = i;
+                        b->node[b->n] = static_cast<node_t>(x);
+                        if (++b->n == kPipeBatch) flush(d);
+                    }
+                });
+                for (uint32_t d = 0; d < S; ++d) {
+                    if (cur[d]) flush(d);
+                    rings[h * S + d]->close();
+                }
+            });
+        });
+    }
+    for (uint32_t sc = 0; sc < S; ++sc) {
+        workers.emplace_back([&, sc]() {
+            pw.run(H + sc, [&]() {
+                const LineStager<Entry> st{ store.data(), lines, base };
+                for (;;) {
+                    bool progress = false, done = true;
+                    for (uint32_t h = 0; h < H; ++h) {
+                        Ring& q = *rings[h * S + sc];
+                        while (EdgeBatch* b = q.front()) {
+                            for (uint32_t k = 0; k < b->n; ++k) {
+                                const uint64_t x = b->node[k];
+                                const Entry e = static_cast<Entry>(b->idx[k] | (((x >> bb) & res_mask) << eb));
+                                if (lines) st.put(s.cursor[x & bucket_mask], x & bucket_mask, e);
+                                else store[s.cursor[x & bucket_mask]++] = e;
+                            }
+                            q.pop();
+                            progress = true;
+                        }
+                        if (!q.finished()) done = false;
+                    }
+                    if (done) break;
+                    if (!progress) std::this_thread::yield();
+                }
+                if (lines) {
+                    for (uint64_t d = 0; d < B; ++d)
+                        if (((d * S) >> bb) == sc) st.drain(s.cursor[d], d);
+                    stream_fence();
+                }
+            });
+        });
+    }
+    for (auto& t : workers) t.join();
+    pw.record();
+}
+
+// Enumerate all k-cycles on the trimmed subgraph.
+size_t MeanSolver::recover_cycles_k(const SummaryBitset& edge_alive, uint32_t k, std::vector<std::vector<uint64_t>>& solutions) const {
+    return recover_all_cycles_k(src_, edge_alive, k, solutions, 0, recovery_threads_ ? recovery_threads_ : threads_, perf_);
 }
 
 MeanResult MeanSolver::solve(uint32_t max_rounds, uint32_t cycle_length) {
-    const uint64_t N = p_.N;
     MeanResult res;
 
-    const size_t words_e = words_for_bits(N);
-    std::vector<uint64_t> edge_alive; init_edge_alive(edge_alive);
-    std::vector<uint64_t> new_edge_alive(words_e, 0ULL);
+    std::unique_ptr<PerfCounters> counters;
+    if (perf_enabled_) {
+        counters.reset(new PerfCounters());
+        res.perf.enabled = true;
+        res.perf.available = counters->available();
+        res.perf.error = counters->error();
+        perf_ = &res.perf;
+        counters_ = counters.get();
+    }
+    if (mem_enabled_) {
+        res.mem.begin();
+        mem_ = &res.mem;
+    }
+
+    SummaryBitset edge_alive;
+    trim_into(edge_alive, max_rounds, cycle_length, res);
+    recover(edge_alive, cycle_length, res);
+
+    if (mem_) res.mem.end();
+    perf_ = nullptr;
+    counters_ = nullptr;
+    mem_ = nullptr;
+    return res;
+}
+
+MeanResult MeanSolver::trim(SummaryBitset& edge_alive, uint32_t max_rounds, uint32_t cycle_length) const {
+    MeanResult res;
+    trim_into(edge_alive, max_rounds, cycle_length, res);
+    return res;
+}
+
+void MeanSolver::trim_into(SummaryBitset& edge_alive, uint32_t max_rounds, uint32_t cycle_length, MeanResult& res) const {
+    const uint64_t N = p_.N;
+    res.bucket_bits = bucket_bits_;
+    res.passes = passes();
+    res.entry_bytes = entry_bytes_;
+    res.fine_bits = fine_bits();
+
+    init_edge_alive(edge_alive);
+    SummaryBitset new_edge_alive(N);
+    Scratch scratch;
+
+    // The peeler runs next to the two edge bitsets once the trimming scratch is released
+    const size_t edge_bitsets = 2 * SummaryBitset::memory_bytes(N);
+    auto peel_fits = [&](uint64_t edges) {
+        const double budget = memcap_bpe_ > 0.0 ? memcap_bpe_ * static_cast<double>(N)
+                                                : static_cast<double>(scratch.peak_bytes);
+        return static_cast<double>(edge_bitsets + peel_memory_bytes(edges)) <= budget;
+    };
 
     uint64_t alive = N;
-    for (uint32_t r = 0; r < max_rounds; ++r) {
+    bool converged = false;
+    for (uint32_t r = 0; r < max_rounds && !peel_fits(alive); ++r) {
         // Alternate sides each round
-        uint64_t kept0 = trim_side_bucketed(edge_alive, new_edge_alive, 0);
+        uint64_t kept0 = trim_side_bucketed(edge_alive, new_edge_alive, 0, scratch);
         edge_alive.swap(new_edge_alive);
-        uint64_t kept1 = trim_side_bucketed(edge_alive, new_edge_alive, 1);
+        uint64_t kept1 = trim_side_bucketed(edge_alive, new_edge_alive, 1, scratch);
         edge_alive.swap(new_edge_alive);
 
         res.rounds_run = r + 1;
         res.alive_edges = kept1;
+        edge_alive.release_empty();
+        new_edge_alive.release_empty();
+        if (mem_) mem_->record_round();
 
-        if (kept1 == alive) break;
+        if (kept1 == alive) { converged = true; break; }
         alive = kept1;
         if (alive == 0) break;
     }
 
-    std::vector<uint64_t> solution;
-    if (recover_cycle_k(edge_alive, cycle_length, solution)) {
+    res.peak_bytes = scratch.peak_bytes;
+    res.scatter_bytes = scratch.scatter_bytes;
+    res.scatter_s = static_cast<double>(scratch.scatter_ns) * 1e-9;
+    if (!converged && alive > 0 && peel_fits(alive)) {
+        scratch = Scratch();
+        PerfScope ps(perf_, counters_, Phase::Peel);
+        MemScope ms(mem_, Phase::Peel);
+        const PeelStats st = peel_leaves(src_, edge_alive);
+        res.peeled_edges = st.removed;
+        res.alive_edges = st.remaining;
+        res.peak_bytes = std::max(res.peak_bytes, edge_bitsets + st.bytes);
+    }
+
+    // Drop components that can't hold a k-cycle, within the peeler's budget
+    const double budget = memcap_bpe_ > 0.0 ? memcap_bpe_ * static_cast<double>(N) : static_cast<double>(res.peak_bytes);
+    if (res.alive_edges > 0 && static_cast<double>(edge_bitsets + prune_memory_bytes(res.alive_edges)) <= budget) {
+        scratch = Scratch();
+        PerfScope ps(perf_, counters_, Phase::Peel);
+        MemScope ms(mem_, Phase::Peel);
+        const PruneStats st = prune_components(src_, edge_alive, cycle_length, threads_, perf_);
+        res.pruned_edges = st.removed;
+        res.alive_edges = st.remaining;
+        res.peak_bytes = std::max(res.peak_bytes, edge_bitsets + st.bytes);
+    }
+    scratch = Scratch();
+    SummaryBitset().swap(new_edge_alive);
+    edge_alive.release_empty();
+    trim_heap();
+    res.mem_bytes_per_edge = N ? static_cast<double>(res.peak_bytes) / static_cast<double>(N) : 0.0;
+}
+
+void MeanSolver::recover(const SummaryBitset& edge_alive, uint32_t cycle_length, MeanResult& res) const {
+    PerfScope ps(perf_, counters_, Phase::Recovery);
+    MemScope ms(mem_, Phase::Recovery);
+    recover_cycles_k(edge_alive, cycle_length, res.solutions);
+    if (!res.solutions.empty()) {
         res.success = true;
-        res.solution_edges = std::move(solution);
-        res.note = "Solution found (bucketed DSU/BFS recovery).";
+        res.solution_edges = res.solutions[0];
+        res.note = "Solution found (bucketed DSU/BFS recovery" + (res.solutions.size() > 1 ? ", " + std::to_string(res.solutions.size()) + " cycles" : std::string()) + ").";
     } else {
         res.success = false;
         res.note = "No cycle found in recovery.";
     }
-
-    return res;
 }
 
 } // namespace cuckoo_sip
@@ -1,48 +1,191 @@
 #ifndef CUCKOO_SIP_MEAN_SOLVER_H
 #define CUCKOO_SIP_MEAN_SOLVER_H
 
+#include <algorithm>
 #include <cstdint>
 #include <vector>
 #include <string>
 
 #include "graph.h"
+#include "edge_source.h"
+#include "summary_bitset.h"
+#include "perf_counters.h"
+#include "mem_track.h"
 
 namespace cuckoo_sip {
 
 struct MeanResult {
     bool success = false;
-    std::vector<uint64_t> solution_edges;
+    std::vector<uint64_t> solution_edges;              // the first of solutions
+    std::vector<std::vector<uint64_t>> solutions;      // every distinct k-cycle in the trimmed graph
     size_t rounds_run = 0;
     size_t alive_edges = 0;
+    uint64_t peeled_edges = 0;       // removed by the worklist peeler after trimming handed over
+    uint64_t pruned_edges = 0;       // in components too small or acyclic for a k-cycle, dropped before recovery
+    size_t peak_bytes = 0;           // measured peak of trimming structures (bitsets, buckets, counters)
+    double mem_bytes_per_edge = 0.0; // peak_bytes / N
+    uint32_t bucket_bits = 0;        // layout actually used (may differ from the request under a memcap)
+    uint32_t passes = 1;             // node-range passes per side
+    uint32_t entry_bytes = 8;        // bucket entry width
+    uint32_t fine_bits = 0;          // second-level radix bits applied to large buckets (0 = single level)
+    uint64_t scatter_bytes = 0;      // bucket entry bytes written by the scatter, all rounds
+    double scatter_s = 0.0;          // wall time of those scatters
+    PerfReport perf;                 // per-phase hardware counters when enabled
+    MemReport mem;                   // tracked bytes per structure and RSS per phase when enabled
     std::string note;
 };
 
 // Open-memory bucketed solver: trims by buckets on low bits of endpoints to accelerate degree counting.
+// Bucket entries pack the edge index with the endpoint's remaining node bits, so degree counting runs
+// on small per-bucket bitmaps without rehashing. With a memcap the solver picks bucket_bits, entry
+// width and the number of node-range passes (each pass buckets only endpoints in 1/P of the node
+// space) so that the estimated peak stays under memcap * N bytes.
 class MeanSolver {
 public:
-    MeanSolver(const Params& params, uint32_t threads, uint32_t bucket_bits = 12);
+    // memcap_bytes_per_edge == 0 means unbounded (single pass, requested bucket_bits).
+    MeanSolver(const Params& params, uint32_t threads, uint32_t bucket_bits = 12, double memcap_bytes_per_edge = 0.0);
 
     // Perform alternating side-based bucketed trimming for up to max_rounds, then attempt k-cycle recovery.
+    // Trimming hands over to the worklist peeler once it fits the memcap (unbounded: the peak that
+    // trimming itself reached), so max_rounds only bounds the early, dense phase. Components that
+    // can't hold a k-cycle are dropped before recovery (components.h).
     MeanResult solve(uint32_t max_rounds = 8, uint32_t cycle_length = 42);
 
+    // solve() in two phases, as LeanSolver::trim / recover: trim() leaves the survivors in
+    // edge_alive with the buckets and peeler released, recover() completes res. Neither collects
+    // perf or memory reports.
+    MeanResult trim(SummaryBitset& edge_alive, uint32_t max_rounds = 8, uint32_t cycle_length = 42) const;
+    void recover(const SummaryBitset& edge_alive, uint32_t cycle_length, MeanResult& res) const;
+
+    // Estimated peak trimming memory for the chosen layout
+    size_t memory_usage_bytes() const;
+    double mem_bytes_per_edge() const;
+
+    uint32_t bucket_bits() const { return bucket_bits_; }
+    uint32_t passes() const { return 1U << pass_bits_; }
+    uint32_t entry_bytes() const { return entry_bytes_; }
+
+    // Capture per-phase hardware counters into MeanResult::perf (off by default). Seeding covers
+    // histogram + scatter, count the in-cache bucket marking, filter the survivor bitmap writes.
+    void set_perf(bool enabled) { perf_enabled_ = enabled; }
+
+    // Collect MeanResult::mem (off by default): peak RSS per phase on top of the always-on
+    // per-structure byte tracking.
+    void set_mem_report(bool enabled) { mem_enabled_ = enabled; }
+
+    // Pipelined scatter: hash_threads hashers partition the alive edges and hand (index, node)
+    // batches over SPSC rings to scatter_threads writers, each owning a contiguous block of
+    // buckets. Both 0 (default) keeps the single-threaded hash-and-scatter loop. The rings and
+    // per-hasher histograms count against the memcap, so the layout is chosen again.
+    void set_pipeline(uint32_t hash_threads, uint32_t scatter_threads);
+
+    // Read endpoints from src (precomputed RAM or mapped table) instead of hashing; throws if src
+    // is for another graph. Tables are graph input and don't count against the memcap.
+    void set_edge_source(const EdgeSource& src);
+
+    // Non-temporal scatter: entries are staged in one cache line per bucket and full lines are
+    // written with streaming stores, skipping the read-for-ownership of the destination. Bucket
+    // slices are padded to line boundaries; staging and padding count against the memcap.
+    void set_nt_stores(bool enabled);
+
+    // Two-level radix: before degree counting, a bucket much larger than 2^fine_bits is split in
+    // cache by the top fine_bits of its residual node bits, so each sub-bucket's seen/nonleaf
+    // bitmaps span 2^(residual - fine_bits) bits and stay in L1. Gets small-bitmap counting without
+    // a 2^(bucket_bits + fine_bits)-way scatter. The split buffer (one bucket) counts against the
+    // memcap. 0 (default) counts whole buckets.
+    void set_fine_bucket_bits(uint32_t fine_bits);
+
+    // Fused side passes (off by default): the scatter scan also histograms the other side, so the
+    // next pass skips its histogram scan and sizes its slices from this pass's edges (an upper
+    // bound on the survivors). Both endpoints come from one hash call. Not with the pipelined
+    // scatter; the second histogram counts against the memcap.
+    void set_fused(bool enabled);
+
+    // Threads for recovery (0 = threads, the default), as LeanSolver::set_recovery_threads
+    void set_recovery_threads(uint32_t threads) { recovery_threads_ = threads; }
+
 private:
     const Params p_;
     const uint32_t threads_;
-    const uint32_t bucket_bits_;
+    const double memcap_bpe_;
+    EdgeSource src_;
+    bool perf_enabled_ = false;
+    PerfReport* perf_ = nullptr;      // set for the duration of solve() when enabled
+    PerfCounters* counters_ = nullptr;
+    bool mem_enabled_ = false;
+    MemReport* mem_ = nullptr;        // set for the duration of solve() when enabled
+    const uint32_t requested_bucket_bits_;
+    uint32_t bucket_bits_ = 12;
+    uint32_t pass_bits_ = 0;  // P = 2^pass_bits node-range passes per side
+    uint32_t entry_bytes_ = 8;
+    uint32_t hash_threads_ = 0;
+    uint32_t scatter_threads_ = 0;
+    bool nt_stores_ = false;
+    uint32_t fine_bits_ = 0;
+    bool fused_ = false;
+    uint32_t recovery_threads_ = 0;
+
+    template <typename T>
+    using BucketVec = tracked_vector<T, MemTag::Buckets>;
+
+    // Working storage reused across side passes
+    struct Scratch {
+        BucketVec<uint64_t> hist;       // P x B entry counts
+        BucketVec<uint64_t> hist_local; // per-hasher P x B counts (pipelined histogram)
+        BucketVec<uint64_t> hist_next;  // fused: P x B counts of the other side, for the next pass
+        bool hist_ready = false;        // fused: hist already bounds this pass's buckets
+        BucketVec<uint64_t> cursor;     // B write cursors for the current range
+        BucketVec<uint32_t> store32;    // bucket entries (4-byte layout)
+        BucketVec<uint64_t> store64;    // bucket entries (8-byte layout)
+        BucketVec<uint32_t> stage32;    // per-bucket staging lines for non-temporal scatter
+        BucketVec<uint64_t> stage64;
+        BucketVec<uint32_t> fine32;     // one bucket split by the second radix level
+        BucketVec<uint64_t> fine64;
+        BucketVec<uint64_t> fine_hist;  // 2^fine_bits + 1 sub-bucket offsets
+        BucketVec<uint64_t> seen;       // per-bucket degree bitmaps over the residual node bits
+        BucketVec<uint64_t> nonleaf;
+        size_t peak_bytes = 0;
+        uint64_t scatter_bytes = 0;
+        uint64_t scatter_ns = 0;
+    };
 
     // Bitset helpers (like lean, but local to mean solver)
     static inline size_t words_for_bits(uint64_t nbits) { return static_cast<size_t>((nbits + 63ULL) / 64ULL); }
-    static inline bool bit_get(const std::vector<uint64_t>& v, uint64_t idx) { return (v[idx >> 6] >> (idx & 63ULL)) & 1ULL; }
-    static inline void bit_set(std::vector<uint64_t>& v, uint64_t idx) { v[idx >> 6] |= (1ULL << (idx & 63ULL)); }
+    static inline bool bit_get(const BucketVec<uint64_t>& v, uint64_t idx) { return (v[idx >> 6] >> (idx & 63ULL)) & 1ULL; }
+    static inline void bit_set(BucketVec<uint64_t>& v, uint64_t idx) { v[idx >> 6] |= (1ULL << (idx & 63ULL)); }
+
+    inline uint32_t residual_bits() const {
+        return p_.edge_bits > bucket_bits_ + pass_bits_ ? p_.edge_bits - bucket_bits_ - pass_bits_ : 0;
+    }
+    // Second-level bits actually used (never more than the residual)
+    inline uint32_t fine_bits() const { return std::min(fine_bits_, residual_bits()); }
+
+    // Estimated peak bytes for a candidate layout
+    size_t estimate_bytes(uint32_t bucket_bits, uint32_t pass_bits, uint32_t entry_bytes) const;
+    // Choose bucket_bits / pass_bits / entry width to satisfy the memcap (throws if impossible)
+    void choose_layout(uint32_t requested_bucket_bits);
 
     // Initialize all edges as alive (N bits set)
-    void init_edge_alive(std::vector<uint64_t>& edge_alive) const;
+    void init_edge_alive(SummaryBitset& edge_alive) const;
 
     // One trimming pass on a single side using bucketed degree counting; returns kept edge count.
-    uint64_t trim_side_bucketed(const std::vector<uint64_t>& edge_alive, std::vector<uint64_t>& new_edge_alive, int side) const;
+    uint64_t trim_side_bucketed(const SummaryBitset& edge_alive, SummaryBitset& new_edge_alive,
+                                int side, Scratch& s) const;
+    template <typename Entry>
+    uint64_t trim_side_entries(const SummaryBitset& edge_alive, SummaryBitset& new_edge_alive,
+                               int side, Scratch& s, BucketVec<Entry>& store, BucketVec<Entry>& stage,
+                               BucketVec<Entry>& fine) const;
+    // Histogram / scatter of one range pass split across hasher and scatter threads
+    void histogram_pipelined(const SummaryBitset& edge_alive, int side, Scratch& s) const;
+    template <typename Entry>
+    void scatter_pipelined(const SummaryBitset& edge_alive, int side, uint64_t range,
+                           Scratch& s, BucketVec<Entry>& store, Entry* lines, uint64_t base) const;
+
+    // Bucketed trimming, peeling and component pruning of solve()
+    void trim_into(SummaryBitset& edge_alive, uint32_t max_rounds, uint32_t cycle_length, MeanResult& res) const;
 
-    // Attempt cycle recovery for a target cycle length k using DSU+BFS on the forest of remaining edges.
-    bool recover_cycle_k(const std::vector<uint64_t>& edge_alive, uint32_t k, std::vector<uint64_t>& solution) const;
+    // Enumerate every k-cycle among the remaining edges; returns the number found.
+    size_t recover_cycles_k(const SummaryBitset& edge_alive, uint32_t k, std::vector<std::vector<uint64_t>>& solutions) const;
 };
 
 } // namespace cuckoo_sip
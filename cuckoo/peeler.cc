@@ -0,0 +1,97 @@
+#include "peeler.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mem_track.h"
+
+namespace cuckoo_sip {
+
+template <typename T>
+using PeelVec = tracked_vector<T, MemTag::Peel>;
+
+size_t peel_memory_bytes(uint64_t alive_edges) {
+    // edge indices + sort keys + per side (incidence, local node id, offsets, degrees, worklist) + alive flags
+    return static_cast<size_t>(alive_edges) * (8 + 8 + 2 * (4 + 4 + 4 + 4 + 4) + 1) + 64;
+}
+
+PeelStats peel_leaves(const EdgeSource& src, SummaryBitset& edge_alive) {
+    PeelStats st;
+    const uint32_t M = static_cast<uint32_t>(edge_alive.count());
+    PeelVec<uint64_t> edges;
+    PeelVec<uint32_t> node_of[2], off[2], inc[2], deg[2];
+    edges.reserve(M);
+    node_of[0].reserve(M);
+    node_of[1].reserve(M);
+
+    // Raw endpoints are parked in node_of until each side is relabelled
+    edge_alive.for_each_word([&](size_t w, uint64_t m) {
+        node_t us[64], vs[64];
+        src.word_endpoints(w, m, us, vs);
+        for (; m; m &= m - 1) {
+            const uint32_t b = static_cast<uint32_t>(__builtin_ctzll(m));
+            edges.push_back((static_cast<uint64_t>(w) << 6) | b);
+            node_of[0].push_back(us[b]);
+            node_of[1].push_back(vs[b]);
+        }
+    });
+
+    // Per side: relabel endpoints to dense ids by sorting (node << 32 | edge), then CSR incidence
+    PeelVec<uint64_t> keys(M);
+    for (int side = 0; side < 2; ++side) {
+        for (uint32_t e = 0; e < M; ++e) keys[e] = (static_cast<uint64_t>(node_of[side][e]) << 32) | e;
+        std::sort(keys.begin(), keys.end());
+        inc[side].resize(M);
+        off[side].reserve(M + 1);
+        uint32_t id = 0;
+        for (uint32_t j = 0; j < M; ++j) {
+            if (j == 0 || (keys[j] >> 32) != (keys[j - 1] >> 32)) { off[side].push_back(j); id = static_cast<uint32_t>(off[side].size() - 1); }
+            const uint32_t e = static_cast<uint32_t>(keys[j]);
+            inc[side][j] = e;
+            node_of[side][e] = id;
+        }
+        off[side].push_back(M);
+        const size_t nodes = off[side].size() - 1;
+        deg[side].resize(nodes);
+        for (size_t n = 0; n < nodes; ++n) deg[side][n] = off[side][n + 1] - off[side][n];
+    }
+    PeelVec<uint64_t>().swap(keys);
+
+    // Worklist of (side, node) leaves, encoded as node << 1 | side. A node is pushed only when its
+    // degree is or drops to 1, and degrees never grow, so each node is pushed at most once.
+    PeelVec<uint8_t> alive(M, 1);
+    PeelVec<uint32_t> work;
+    work.reserve(deg[0].size() + deg[1].size());
+    for (int side = 0; side < 2; ++side)
+        for (uint32_t n = 0; n < deg[side].size(); ++n)
+            if (deg[side][n] == 1) work.push_back((n << 1) | static_cast<uint32_t>(side));
+
+    for (int side = 0; side < 2; ++side)
+        st.bytes += (node_of[side].capacity() + off[side].capacity() + inc[side].capacity() + deg[side].capacity()) * sizeof(uint32_t);
+    st.bytes += edges.capacity() * sizeof(uint64_t) + M * sizeof(uint64_t) /* sort keys, freed */ + alive.capacity();
+    st.bytes += work.capacity() * sizeof(uint32_t);
+
+    while (!work.empty()) {
+        const uint32_t w = work.back();
+        work.pop_back();
+        const int side = static_cast<int>(w & 1U);
+        const uint32_t n = w >> 1;
+        if (deg[side][n] != 1) continue; // already isolated by an earlier removal
+        // The node's one remaining edge
+        uint32_t e = 0;
+        for (uint32_t j = off[side][n]; j < off[side][n + 1]; ++j) {
+            if (alive[inc[side][j]]) { e = inc[side][j]; break; }
+        }
+        alive[e] = 0;
+        edge_alive.clear_bit(edges[e]);
+        ++st.removed;
+        deg[side][n] = 0;
+        const int other = side ^ 1;
+        const uint32_t m = node_of[other][e];
+        if (--deg[other][m] == 1) work.push_back((m << 1) | static_cast<uint32_t>(other));
+    }
+    st.remaining = M - st.removed;
+    return st;
+}
+
+} // namespace cuckoo_sip
@@ -0,0 +1,29 @@
+#ifndef CUCKOO_SIP_PEELER_H
+#define CUCKOO_SIP_PEELER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "edge_source.h"
+#include "summary_bitset.h"
+
+namespace cuckoo_sip {
+
+struct PeelStats {
+    uint64_t removed = 0;    // edges peeled off
+    uint64_t remaining = 0;  // edges left (the 2-core)
+    size_t bytes = 0;        // working memory allocated over the call
+};
+
+// Upper bound on peel_leaves working memory for a given number of alive edges
+size_t peel_memory_bytes(uint64_t alive_edges);
+
+// Worklist leaf peeling for the late phase, once few edges survive: builds exact degrees and
+// node->edge incidence for the alive edges, then removes degree-1 nodes transitively on both
+// sides. Work after setup is proportional to the edges removed. Clears the removed edges in
+// edge_alive, leaving exactly the 2-core. Shared by the lean and mean solvers.
+PeelStats peel_leaves(const EdgeSource& src, SummaryBitset& edge_alive);
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_PEELER_H
@@ -0,0 +1,342 @@
+#include "recovery.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "mem_track.h"
+
+namespace cuckoo_sip {
+
+namespace {
+
+template <typename T>
+using RecVec = tracked_vector<T, MemTag::Recovery>;
+
+// Alive subgraph with dense node ids (side 0 and side 1 nodes share one id space) and CSR incidence
+struct LocalGraph {
+    struct Edge { uint32_t a; uint32_t b; uint64_t idx; };
+    RecVec<Edge> edges;
+    RecVec<uint32_t> off;   // node -> first slot in inc
+    RecVec<uint32_t> inc;   // incident local edge ids
+    RecVec<uint8_t> alive;  // local edge still in the graph
+
+    uint32_t other(uint32_t e, uint32_t n) const { return edges[e].a == n ? edges[e].b : edges[e].a; }
+};
+
+// Every table below is sized exactly (no geometric growth) so recovery_memory_bytes() is a bound.
+void build_local(const EdgeSource& src, const SummaryBitset& edge_alive, LocalGraph& g) {
+    const size_t M = static_cast<size_t>(edge_alive.count());
+    g.edges.resize(M);
+    size_t e = 0;
+    edge_alive.for_each_word([&](size_t w, uint64_t m) {
+        node_t us[64], vs[64];
+        src.word_endpoints(w, m, us, vs);
+        for (; m; m &= m - 1) {
+            const uint32_t bit = static_cast<uint32_t>(__builtin_ctzll(m));
+            g.edges[e++] = LocalGraph::Edge{ us[bit], vs[bit], (static_cast<uint64_t>(w) << 6) | bit };
+        }
+    });
+
+    // Relabel each side by sorting (node << 32 | edge); side 1 ids follow side 0's
+    uint32_t nodes = 0;
+    {
+        RecVec<uint64_t> keys(M);
+        for (int side = 0; side < 2; ++side) {
+            for (size_t j = 0; j < M; ++j)
+                keys[j] = (static_cast<uint64_t>(side ? g.edges[j].b : g.edges[j].a) << 32) | j;
+            std::sort(keys.begin(), keys.end());
+            for (size_t j = 0; j < M; ++j) {
+                if (j == 0 || (keys[j] >> 32) != (keys[j - 1] >> 32)) ++nodes;
+                LocalGraph::Edge& ed = g.edges[static_cast<uint32_t>(keys[j])];
+                (side ? ed.b : ed.a) = nodes - 1;
+            }
+        }
+    }
+
+    // Counts land in off[n + 2]; after the prefix sum off[n + 1] is n's fill cursor and ends at n's end
+    g.off.assign(static_cast<size_t>(nodes) + 2, 0);
+    for (const auto& ed : g.edges) { ++g.off[ed.a + 2]; ++g.off[ed.b + 2]; }
+    for (size_t n = 2; n < g.off.size(); ++n) g.off[n] += g.off[n - 1];
+    g.inc.resize(M * 2);
+    for (uint32_t j = 0; j < M; ++j) {
+        g.inc[g.off[g.edges[j].a + 1]++] = j;
+        g.inc[g.off[g.edges[j].b + 1]++] = j;
+    }
+    g.off.pop_back();
+    g.alive.assign(M, 1);
+}
+
+// Remove degree-1 nodes transitively (trimming may have stopped early)
+void strip_leaves(LocalGraph& g, RecVec<uint32_t>& deg) {
+    const size_t nodes = g.off.size() - 1;
+    deg.resize(nodes);
+    RecVec<uint32_t> work;
+    work.reserve(nodes);
+    for (uint32_t n = 0; n < nodes; ++n) {
+        deg[n] = g.off[n + 1] - g.off[n];
+        if (deg[n] == 1) work.push_back(n);
+    }
+    while (!work.empty()) {
+        const uint32_t n = work.back();
+        work.pop_back();
+        if (deg[n] != 1) continue;
+        for (uint32_t j = g.off[n]; j < g.off[n + 1]; ++j) {
+            const uint32_t e = g.inc[j];
+            if (!g.alive[e]) continue;
+            g.alive[e] = 0;
+            deg[n] = 0;
+            const uint32_t m = g.other(e, n);
+            if (--deg[m] == 1) work.push_back(m);
+            break;
+        }
+    }
+}
+
+struct DSU {
+    RecVec<uint32_t> parent;
+    explicit DSU(size_t n) : parent(n) { for (size_t i = 0; i < n; ++i) parent[i] = static_cast<uint32_t>(i); }
+    uint32_t find(uint32_t x) {
+        while (parent[x] != x) { parent[x] = parent[parent[x]]; x = parent[x]; }
+        return x;
+    }
+};
+
+// Per-thread search state; dist and on_path span every local node
+struct SearchTables {
+    RecVec<uint32_t> dist;
+    RecVec<uint8_t> on_path;
+    RecVec<uint32_t> path;
+    RecVec<uint32_t> order; // BFS order from the root (also the nodes whose dist to reset)
+    RecVec<std::pair<uint32_t, uint32_t>> stack;
+
+    SearchTables(size_t nodes, uint32_t k) : dist(nodes, UINT32_MAX), on_path(nodes, 0) {
+        path.reserve(k);
+        stack.reserve(k);
+        order.reserve(nodes);
+    }
+};
+
+// Cycles rooted at their smallest edge index e0, traversed from edges[e0].a through edges[e0].b
+// and closing back at edges[e0].a using only edges with larger indices.
+template <class Emit, class Stop>
+void search_root(const LocalGraph& g, uint32_t e0, uint32_t k, SearchTables& tb, Emit&& emit, Stop&& stop) {
+    auto& dist = tb.dist;
+    auto& on_path = tb.on_path;
+    auto& path = tb.path;
+    auto& order = tb.order;
+    auto& stack = tb.stack;
+    const uint64_t i0 = g.edges[e0].idx;
+    const uint32_t root = g.edges[e0].a;
+    auto usable = [&](uint32_t f) { return g.alive[f] && g.edges[f].idx > i0; };
+
+    // Distance back to root over usable edges, up to k-1 steps
+    order.assign(1, root);
+    dist[root] = 0;
+    for (size_t head = 0; head < order.size(); ++head) {
+        const uint32_t x = order[head];
+        if (dist[x] + 1 >= k) continue;
+        for (uint32_t j = g.off[x]; j < g.off[x + 1]; ++j) {
+            const uint32_t f = g.inc[j];
+            if (!usable(f)) continue;
+            const uint32_t y = g.other(f, x);
+            if (dist[y] != UINT32_MAX) continue;
+            dist[y] = dist[x] + 1;
+            order.push_back(y);
+        }
+    }
+    const uint32_t start = g.edges[e0].b;
+    if (dist[start] != UINT32_MAX && dist[start] <= k - 1) {
+        path.assign(1, e0);
+        on_path[root] = on_path[start] = 1;
+        // Iterative DFS: frame = (node, next incidence slot)
+        stack.assign(1, { start, g.off[start] });
+        while (!stack.empty() && !stop()) {
+            auto& top = stack.back();
+            const uint32_t x = top.first;
+            if (top.second == g.off[x + 1]) {
+                on_path[x] = 0;
+                stack.pop_back();
+                path.pop_back();
+                continue;
+            }
+            const uint32_t f = g.inc[top.second++];
+            if (!usable(f)) continue;
+            const uint32_t y = g.other(f, x);
+            const uint32_t len = static_cast<uint32_t>(path.size()) + 1;
+            if (y == root) {
+                if (len == k) {
+                    std::vector<uint64_t> sol;
+                    for (uint32_t pe : path) sol.push_back(g.edges[pe].idx);
+                    sol.push_back(g.edges[f].idx);
+                    emit(std::move(sol));
+                }
+                continue;
+            }
+            if (on_path[y] || dist[y] == UINT32_MAX || len + dist[y] > k) continue;
+            on_path[y] = 1;
+            path.push_back(f);
+            stack.push_back({ y, g.off[y] });
+        }
+        on_path[root] = 0;
+        for (const auto& fr : stack) on_path[fr.first] = 0;
+    }
+    for (uint32_t n : order) dist[n] = UINT32_MAX;
+}
+
+// Searches the roots at comp_list positions [p0, p1); emit(solution, position)
+template <class Emit, class Stop>
+void search_roots(const LocalGraph& g, const RecVec<uint32_t>& comp_off, const RecVec<uint32_t>& comp_list,
+                  const RecVec<uint32_t>& comp_nodes, size_t p0, size_t p1, uint32_t k, SearchTables& tb,
+                  Emit&& emit, Stop&& stop) {
+    size_t c = static_cast<size_t>(std::upper_bound(comp_off.begin(), comp_off.end(), p0) - comp_off.begin()) - 1;
+    for (size_t pos = p0; pos < p1 && !stop(); ++pos) {
+        while (comp_off[c + 1] <= pos) ++c;
+        const size_t ce = comp_off[c + 1] - comp_off[c];
+        if (ce < k) { pos = comp_off[c + 1] - 1; continue; }
+        auto emit_at = [&](std::vector<uint64_t>&& sol) { emit(std::move(sol), pos); };
+
+        if (ce == comp_nodes[c]) {
+            // Every node has degree 2: the component is one cycle of ce edges, walked from its first root
+            if (ce == k && pos == comp_off[c]) {
+                std::vector<uint64_t> sol;
+                uint32_t e = comp_list[pos], n = g.edges[e].b;
+                for (uint32_t step = 0; step < k; ++step) {
+                    sol.push_back(g.edges[e].idx);
+                    for (uint32_t j = g.off[n]; j < g.off[n + 1]; ++j) {
+                        const uint32_t f = g.inc[j];
+                        if (f != e && g.alive[f]) { e = f; break; }
+                    }
+                    n = g.other(e, n);
+                }
+                emit_at(std::move(sol));
+            }
+            pos = comp_off[c + 1] - 1;
+            continue;
+        }
+        search_root(g, comp_list[pos], k, tb, emit_at, stop);
+    }
+}
+
+// Per alive edge (at most 2 nodes per edge, 4-byte ids): the local graph holds 16 edges + 8 off +
+// 8 inc + 1 alive throughout; on top the largest phase is components, with 8 deg + 8 DSU +
+// 8 labels + 8 component tables (a core component has at least 2 edges). Sorting keys (8), the
+// strip worklist (8 + deg) and the search tables (8 + 8 dist + 2 on_path + 8 BFS order) are smaller.
+constexpr size_t kRecoveryBytesPerEdge = 33 + 32;
+// Each search thread past the first adds its own dist, on_path and BFS order
+constexpr size_t kSearchBytesPerEdge = 8 + 2 + 8;
+
+// Fewer core edges than this are searched on one thread; threads claim roots in chunks
+constexpr size_t kMinParallelRoots = 4096;
+constexpr size_t kRootsPerClaim = 64;
+
+} // namespace
+
+size_t recovery_memory_bytes(uint64_t alive_edges, uint32_t k, uint32_t threads) {
+    // Graphs too small to split are searched serially whatever threads says
+    const size_t T = alive_edges < kMinParallelRoots ? 1 : std::max(1U, threads);
+    return static_cast<size_t>(alive_edges) * (kRecoveryBytesPerEdge + (T - 1) * kSearchBytesPerEdge) +
+           T * (static_cast<size_t>(k) * (sizeof(std::pair<uint32_t, uint32_t>) + sizeof(uint32_t)) + 256);
+}
+
+size_t recover_all_cycles_k(const EdgeSource& src, const SummaryBitset& edge_alive, uint32_t k,
+                            std::vector<std::vector<uint64_t>>& solutions, size_t max_solutions, uint32_t threads,
+                            PerfReport* perf) {
+    solutions.clear();
+    if (k < 2) return 0;
+    LocalGraph g;
+    build_local(src, edge_alive, g);
+    if (g.edges.size() < k) return 0;
+
+    // Components of the remaining core as CSR edge lists, numbered by smallest edge index so the
+    // output order is deterministic, with their node counts
+    const size_t nodes = g.off.size() - 1;
+    RecVec<uint32_t> comp_off, comp_list, comp_nodes;
+    {
+        RecVec<uint32_t> deg;
+        strip_leaves(g, deg);
+        DSU dsu(nodes);
+        size_t core = 0;
+        for (uint32_t e = 0; e < g.edges.size(); ++e) {
+            if (!g.alive[e]) continue;
+            dsu.parent[dsu.find(g.edges[e].a)] = dsu.find(g.edges[e].b);
+            ++core;
+        }
+        RecVec<uint32_t> comp_of(nodes, UINT32_MAX);
+        uint32_t comps = 0;
+        for (uint32_t e = 0; e < g.edges.size(); ++e) {
+            if (!g.alive[e]) continue;
+            const uint32_t r = dsu.find(g.edges[e].a);
+            if (comp_of[r] == UINT32_MAX) comp_of[r] = comps++;
+        }
+        comp_off.assign(static_cast<size_t>(comps) + 2, 0);
+        for (uint32_t e = 0; e < g.edges.size(); ++e)
+            if (g.alive[e]) ++comp_off[comp_of[dsu.find(g.edges[e].a)] + 2];
+        for (size_t c = 2; c < comp_off.size(); ++c) comp_off[c] += comp_off[c - 1];
+        comp_list.resize(core);
+        for (uint32_t e = 0; e < g.edges.size(); ++e)
+            if (g.alive[e]) comp_list[comp_off[comp_of[dsu.find(g.edges[e].a)] + 1]++] = e;
+        comp_off.pop_back();
+        comp_nodes.assign(comps, 0);
+        for (uint32_t n = 0; n < nodes; ++n)
+            if (deg[n] > 0) ++comp_nodes[comp_of[dsu.find(n)]];
+    }
+
+    const size_t core = comp_list.size();
+    auto full = [&]() { return max_solutions && solutions.size() >= max_solutions; };
+
+    // Root edges, in component list order, are independent units of work: the serial search
+    // emits in that order, threads claim chunks of them and their output is merged back into it.
+    // A capped search (max_solutions) stays serial so that it returns the same first solutions.
+    const uint32_t T = (max_solutions || core < kMinParallelRoots) ? 1U : std::max(1U, threads);
+    if (T == 1) {
+        SearchTables tb(nodes, k);
+        search_roots(g, comp_off, comp_list, comp_nodes, 0, core, k, tb,
+                     [&](std::vector<uint64_t>&& sol, size_t) { solutions.push_back(std::move(sol)); }, full);
+        return solutions.size();
+    }
+
+    std::atomic<size_t> next{ 0 };
+    std::vector<std::vector<std::pair<size_t, std::vector<uint64_t>>>> found(T);
+    PerfWorkers pw(perf, Phase::Recovery, T);
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < T; ++t) {
+        workers.emplace_back([&, t]() {
+            pw.run(t, [&]() {
+                SearchTables tb(nodes, k);
+                for (;;) {
+                    const size_t p0 = next.fetch_add(kRootsPerClaim, std::memory_order_relaxed);
+                    if (p0 >= core) break;
+                    search_roots(g, comp_off, comp_list, comp_nodes, p0, std::min(core, p0 + kRootsPerClaim), k, tb,
+                                 [&](std::vector<uint64_t>&& sol, size_t pos) { found[t].emplace_back(pos, std::move(sol)); },
+                                 [] { return false; });
+                }
+            });
+        });
+    }
+    for (auto& w : workers) w.join();
+    pw.record();
+
+    // Each root is searched by one thread, which emits its cycles in order
+    std::vector<std::pair<size_t, std::vector<uint64_t>>> all;
+    for (auto& f : found)
+        for (auto& x : f) all.push_back(std::move(x));
+    std::stable_sort(all.begin(), all.end(), [](const auto& x, const auto& y) { return x.first < y.first; });
+    for (auto& x : all) solutions.push_back(std::move(x.second));
+    return solutions.size();
+}
+
+size_t recover_all_cycles_k(const Params& p, const SummaryBitset& edge_alive, uint32_t k,
+                            std::vector<std::vector<uint64_t>>& solutions, size_t max_solutions, uint32_t threads) {
+    return recover_all_cycles_k(EdgeSource(p), edge_alive, k, solutions, max_solutions, threads);
+}
+
+bool recover_cycle_k(const Params& p, const SummaryBitset& edge_alive, uint32_t k, std::vector<uint64_t>& solution) {
+    std::vector<std::vector<uint64_t>> solutions;
+    if (!recover_all_cycles_k(p, edge_alive, k, solutions, 1)) return false;
+    solution = std::move(solutions[0]);
+    return true;
+}
+
+} // namespace cuckoo_sip
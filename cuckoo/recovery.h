@@ -0,0 +1,39 @@
+#ifndef CUCKOO_SIP_RECOVERY_H
+#define CUCKOO_SIP_RECOVERY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "edge_source.h"
+#include "summary_bitset.h"
+#include "perf_counters.h"
+
+namespace cuckoo_sip {
+
+// Enumerates every distinct k-cycle in the subgraph of alive edges. Leaves are stripped first;
+// components that are a single cycle are walked directly, richer components get a DFS rooted at
+// each cycle's smallest edge index (so every cycle is emitted exactly once), pruned by distance
+// back to the root. Each solution lists k edge indices in cycle order. Stops after max_solutions
+// when nonzero; returns the number found. Shared by the lean, mean and batched solvers.
+// Without a cap, larger graphs are searched on up to threads threads, each taking chunks of
+// root edges with private search tables; solutions come back in the same order as serially.
+// With perf, those threads' counters are added to the recovery phase as workers.
+size_t recover_all_cycles_k(const EdgeSource& src, const SummaryBitset& edge_alive, uint32_t k,
+                            std::vector<std::vector<uint64_t>>& solutions, size_t max_solutions = 0,
+                            uint32_t threads = 1, PerfReport* perf = nullptr);
+// Same, hashing endpoints on the fly
+size_t recover_all_cycles_k(const Params& p, const SummaryBitset& edge_alive, uint32_t k,
+                            std::vector<std::vector<uint64_t>>& solutions, size_t max_solutions = 0,
+                            uint32_t threads = 1);
+
+// Upper bound on the working memory of recover_all_cycles_k over alive_edges edges (solutions
+// excluded): every table is sized exactly, so callers under a memcap can check it up front.
+size_t recovery_memory_bytes(uint64_t alive_edges, uint32_t k, uint32_t threads = 1);
+
+// First k-cycle only; on success solution holds k edge indices.
+bool recover_cycle_k(const Params& p, const SummaryBitset& edge_alive, uint32_t k, std::vector<uint64_t>& solution);
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_RECOVERY_H
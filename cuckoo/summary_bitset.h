@@ -0,0 +1,191 @@
+#ifndef CUCKOO_SIP_SUMMARY_BITSET_H
+#define CUCKOO_SIP_SUMMARY_BITSET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include "mem_track.h"
+
+namespace cuckoo_sip {
+
+// Three-level bitset: bit w of summary_ marks words_[w] as possibly nonzero, bit s of top_ marks
+// summary_[s] as possibly nonzero. set() maintains both levels, so scans and clear() touch only
+// live words and cost tracks the number of set bits rather than nbits. Summary bits are
+// conservative: clear_bit() leaves them set, and scans skip words that turned zero.
+class SummaryBitset {
+public:
+    SummaryBitset() = default;
+    explicit SummaryBitset(uint64_t nbits) { reset(nbits); }
+
+    // Resize to nbits, all clear
+    void reset(uint64_t nbits) {
+        nbits_ = nbits;
+        words_.assign(words_for_bits(nbits), 0ULL);
+        summary_.assign(words_for_bits(words_.size()), 0ULL);
+        top_.assign(words_for_bits(summary_.size()), 0ULL);
+    }
+
+    // Set bits [0, nbits)
+    void set_all() {
+        fill_level(words_, nbits_);
+        fill_level(summary_, words_.size());
+        fill_level(top_, summary_.size());
+    }
+
+    // Clear every bit; cost proportional to the live words
+    void clear() {
+        for (size_t t = 0; t < top_.size(); ++t) {
+            uint64_t tm = top_[t];
+            while (tm) {
+                const size_t s = (t << 6) | static_cast<size_t>(__builtin_ctzll(tm));
+                tm &= tm - 1;
+                uint64_t sm = summary_[s];
+                while (sm) {
+                    words_[(s << 6) | static_cast<size_t>(__builtin_ctzll(sm))] = 0ULL;
+                    sm &= sm - 1;
+                }
+                summary_[s] = 0ULL;
+            }
+            top_[t] = 0ULL;
+        }
+    }
+
+    inline bool get(uint64_t idx) const { return (words_[idx >> 6] >> (idx & 63ULL)) & 1ULL; }
+
+    inline void set(uint64_t idx) {
+        const uint64_t w = idx >> 6;
+        words_[w] |= (1ULL << (idx & 63ULL));
+        summary_[w >> 6] |= (1ULL << (w & 63ULL));
+        top_[w >> 12] |= (1ULL << ((w >> 6) & 63ULL));
+    }
+
+    // Pull the word holding idx toward L1 ahead of a get (or, with write, a set)
+    inline void prefetch(uint64_t idx, bool write = false) const {
+        const uint64_t* w = &words_[idx >> 6];
+        if (write) __builtin_prefetch(w, 1); else __builtin_prefetch(w, 0);
+    }
+
+    inline void clear_bit(uint64_t idx) { words_[idx >> 6] &= ~(1ULL << (idx & 63ULL)); }
+
+    // OR a whole word in (used when rebuilding from another layout)
+    inline void or_word(size_t w, uint64_t bits) {
+        if (!bits) return;
+        words_[w] |= bits;
+        summary_[w >> 6] |= (1ULL << (w & 63ULL));
+        top_[w >> 12] |= (1ULL << ((w >> 6) & 63ULL));
+    }
+
+    // f(w, bits) for every nonzero word, in increasing w
+    template <class F>
+    void for_each_word(F&& f) const {
+        for (size_t t = 0; t < top_.size(); ++t) {
+            uint64_t tm = top_[t];
+            while (tm) {
+                const size_t s = (t << 6) | static_cast<size_t>(__builtin_ctzll(tm));
+                tm &= tm - 1;
+                uint64_t sm = summary_[s];
+                while (sm) {
+                    const size_t w = (s << 6) | static_cast<size_t>(__builtin_ctzll(sm));
+                    sm &= sm - 1;
+                    if (words_[w]) f(w, words_[w]);
+                }
+            }
+        }
+    }
+
+    // f(w, bits) for every nonzero word with wb <= w < we (partitions a scan across threads)
+    template <class F>
+    void for_each_word_in(size_t wb, size_t we, F&& f) const {
+        we = std::min(we, words_.size());
+        if (wb >= we) return;
+        const size_t sb = wb >> 6, se = (we - 1) >> 6;
+        for (size_t t = sb >> 6; t <= (se >> 6); ++t) {
+            uint64_t tm = top_[t];
+            while (tm) {
+                const size_t s = (t << 6) | static_cast<size_t>(__builtin_ctzll(tm));
+                tm &= tm - 1;
+                if (s < sb) continue;
+                if (s > se) break;
+                uint64_t sm = summary_[s];
+                while (sm) {
+                    const size_t w = (s << 6) | static_cast<size_t>(__builtin_ctzll(sm));
+                    sm &= sm - 1;
+                    if (w < wb) continue;
+                    if (w >= we) break;
+                    if (words_[w]) f(w, words_[w]);
+                }
+            }
+        }
+    }
+
+    // f(idx) for every set bit, in increasing idx
+    template <class F>
+    void for_each_set(F&& f) const {
+        for_each_word([&](size_t w, uint64_t m) {
+            while (m) {
+                f((static_cast<uint64_t>(w) << 6) | static_cast<uint64_t>(__builtin_ctzll(m)));
+                m &= m - 1;
+            }
+        });
+    }
+
+    uint64_t count() const {
+        uint64_t c = 0;
+        for_each_word([&](size_t, uint64_t m) { c += static_cast<uint64_t>(__builtin_popcountll(m)); });
+        return c;
+    }
+
+    // Release runs of words with a clear summary bit (all zero) to the OS; they read back as zero.
+    // Survivor bitsets only lose bits, so once a run empties it is never written again. Returns
+    // the bytes released.
+    size_t release_empty() {
+        size_t released = 0, s0 = 0;
+        for (size_t s = 0; s <= summary_.size(); ++s) {
+            if (s < summary_.size() && summary_[s] == 0ULL) continue;
+            const size_t w1 = std::min(words_.size(), s << 6);
+            if (w1 > (s0 << 6)) released += release_pages(&words_[s0 << 6], (w1 - (s0 << 6)) * sizeof(uint64_t));
+            s0 = s + 1;
+        }
+        return released;
+    }
+
+    uint64_t size() const { return nbits_; }
+    size_t word_count() const { return words_.size(); }
+    uint64_t word(size_t w) const { return words_[w]; }
+
+    void swap(SummaryBitset& o) {
+        std::swap(nbits_, o.nbits_);
+        words_.swap(o.words_);
+        summary_.swap(o.summary_);
+        top_.swap(o.top_);
+    }
+
+    // Bytes held for nbits (all three levels)
+    static size_t memory_bytes(uint64_t nbits) {
+        const size_t w = words_for_bits(nbits);
+        const size_t s = words_for_bits(w);
+        return (w + s + words_for_bits(s)) * sizeof(uint64_t);
+    }
+
+private:
+    static inline size_t words_for_bits(uint64_t nbits) { return static_cast<size_t>((nbits + 63ULL) / 64ULL); }
+
+    template <typename V>
+    static void fill_level(V& v, uint64_t nbits) {
+        std::fill(v.begin(), v.end(), ~0ULL);
+        if (!v.empty() && (nbits & 63ULL) != 0ULL) v.back() &= (1ULL << (nbits & 63ULL)) - 1ULL;
+    }
+
+    using Words = tracked_vector<uint64_t, MemTag::Bitsets>;
+
+    uint64_t nbits_ = 0;
+    Words words_;
+    Words summary_;
+    Words top_;
+};
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_SUMMARY_BITSET_H
@@ -0,0 +1,174 @@
+#include "mem_track.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace cuckoo_sip {
+
+namespace {
+
+struct TagCounters {
+    std::atomic<size_t> live{ 0 };
+    std::atomic<size_t> peak{ 0 };
+    std::atomic<uint64_t> allocs{ 0 };
+};
+
+TagCounters g_tags[kMemTagCount];
+TagCounters g_total;
+
+void raise_peak(std::atomic<size_t>& peak, size_t v) {
+    size_t cur = peak.load(std::memory_order_relaxed);
+    while (v > cur && !peak.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+const char* mem_tag_name(MemTag tag) {
+    switch (tag) {
+        case MemTag::Bitsets: return "bitsets";
+        case MemTag::Buckets: return "buckets";
+        case MemTag::Peel: return "peel";
+        case MemTag::Recovery: return "recovery";
+        case MemTag::Edges: return "edges";
+    }
+    return "?";
+}
+
+void MemTracker::on_alloc(MemTag tag, size_t bytes) {
+    TagCounters& c = g_tags[static_cast<size_t>(tag)];
+    raise_peak(c.peak, c.live.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    c.allocs.fetch_add(1, std::memory_order_relaxed);
+    raise_peak(g_total.peak, g_total.live.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void MemTracker::on_free(MemTag tag, size_t bytes) {
+    g_tags[static_cast<size_t>(tag)].live.fetch_sub(bytes, std::memory_order_relaxed);
+    g_total.live.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+size_t MemTracker::live_bytes(MemTag tag) {
+    return g_tags[static_cast<size_t>(tag)].live.load(std::memory_order_relaxed);
+}
+
+MemTagStats MemTracker::stats(MemTag tag) {
+    const TagCounters& c = g_tags[static_cast<size_t>(tag)];
+    MemTagStats s;
+    s.peak_bytes = c.peak.load(std::memory_order_relaxed);
+    s.allocs = c.allocs.load(std::memory_order_relaxed);
+    return s;
+}
+
+size_t MemTracker::total_peak_bytes() { return g_total.peak.load(std::memory_order_relaxed); }
+
+void MemTracker::reset_peaks() {
+    for (auto& c : g_tags) {
+        c.peak.store(c.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        c.allocs.store(0, std::memory_order_relaxed);
+    }
+    g_total.peak.store(g_total.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+RssSample read_rss() {
+    RssSample s;
+#if defined(__linux__)
+    if (FILE* f = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (std::fgets(line, sizeof(line), f)) {
+            if (std::strncmp(line, "VmRSS:", 6) == 0) s.rss_kb = std::strtoull(line + 6, nullptr, 10);
+            else if (std::strncmp(line, "VmHWM:", 6) == 0) s.hwm_kb = std::strtoull(line + 6, nullptr, 10);
+        }
+        std::fclose(f);
+    }
+#endif
+    return s;
+}
+
+bool reset_rss_peak() {
+#if defined(__linux__)
+    if (FILE* f = std::fopen("/proc/self/clear_refs", "w")) {
+        const bool ok = std::fputs("5", f) >= 0;
+        return std::fclose(f) == 0 && ok;
+    }
+#endif
+    return false;
+}
+
+size_t max_rss_kb() {
+#if defined(__linux__)
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) return static_cast<size_t>(ru.ru_maxrss);
+#endif
+    return 0;
+}
+
+size_t release_pages(void* p, size_t bytes) {
+#if defined(__linux__)
+    static const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t b = (reinterpret_cast<uintptr_t>(p) + page - 1) & ~(page - 1);
+    const uintptr_t e = (reinterpret_cast<uintptr_t>(p) + bytes) & ~(page - 1);
+    if (e <= b || madvise(reinterpret_cast<void*>(b), e - b, MADV_DONTNEED) != 0) return 0;
+    return e - b;
+#else
+    (void)p;
+    (void)bytes;
+    return 0;
+#endif
+}
+
+void trim_heap() {
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+void MemReport::record_round() { round_rss_kb.push_back(read_rss().rss_kb); }
+
+void MemReport::begin() {
+    enabled = true;
+    MemTracker::reset_peaks();
+    phase_rss_exact = reset_rss_peak();
+}
+
+void MemReport::end() {
+    for (size_t t = 0; t < kMemTagCount; ++t) tags[t] = MemTracker::stats(static_cast<MemTag>(t));
+    tracked_peak_bytes = MemTracker::total_peak_bytes();
+    // VmHWM since the last reset covers the tail; phases cover the rest. Without resets both are
+    // lifetime figures and getrusage is the better-supported source.
+    rss_peak_kb = read_rss().hwm_kb;
+    if (!phase_rss_exact) rss_peak_kb = std::max(rss_peak_kb, max_rss_kb());
+    for (size_t i = 0; i < kPhaseCount; ++i) rss_peak_kb = std::max(rss_peak_kb, phase_rss_peak_kb[i]);
+}
+
+void MemReport::merge(const MemReport& o) {
+    enabled = enabled || o.enabled;
+    phase_rss_exact = phase_rss_exact || o.phase_rss_exact;
+    for (size_t i = 0; i < kPhaseCount; ++i) phase_rss_peak_kb[i] = std::max(phase_rss_peak_kb[i], o.phase_rss_peak_kb[i]);
+    rss_peak_kb = std::max(rss_peak_kb, o.rss_peak_kb);
+    for (size_t t = 0; t < kMemTagCount; ++t) {
+        tags[t].peak_bytes = std::max(tags[t].peak_bytes, o.tags[t].peak_bytes);
+        tags[t].allocs += o.tags[t].allocs;
+    }
+    tracked_peak_bytes = std::max(tracked_peak_bytes, o.tracked_peak_bytes);
+    if (round_rss_kb.size() < o.round_rss_kb.size()) round_rss_kb.resize(o.round_rss_kb.size(), 0);
+    for (size_t r = 0; r < o.round_rss_kb.size(); ++r) round_rss_kb[r] = std::max(round_rss_kb[r], o.round_rss_kb[r]);
+}
+
+MemScope::~MemScope() {
+    if (!report_) return;
+    size_t& peak = report_->phase_rss_peak_kb[static_cast<size_t>(ph_)];
+    peak = std::max(peak, read_rss().hwm_kb);
+}
+
+} // namespace cuckoo_sip
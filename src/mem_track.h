@@ -0,0 +1,124 @@
+#ifndef CUCKOO_SIP_MEM_TRACK_H
+#define CUCKOO_SIP_MEM_TRACK_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include "perf_counters.h"
+
+namespace cuckoo_sip {
+
+// Solver structures whose heap bytes are tracked separately
+enum class MemTag : uint32_t { Bitsets = 0, Buckets = 1, Peel = 2, Recovery = 3, Edges = 4 };
+constexpr size_t kMemTagCount = 5;
+const char* mem_tag_name(MemTag tag);
+
+struct MemTagStats {
+    size_t peak_bytes = 0;   // largest live byte count since the last reset
+    uint64_t allocs = 0;     // allocations since the last reset
+};
+
+// Process-wide live/peak bytes and allocation counts per tag, fed by TrackingAllocator. Counters
+// are atomics, so concurrent solvers in one process share (and sum into) the same totals.
+class MemTracker {
+public:
+    static void on_alloc(MemTag tag, size_t bytes);
+    static void on_free(MemTag tag, size_t bytes);
+    static size_t live_bytes(MemTag tag);
+    static MemTagStats stats(MemTag tag);
+    static size_t total_peak_bytes();  // peak of the sum over tags
+    static void reset_peaks();         // peaks := live bytes, allocation counts := 0
+};
+
+// Stateless std allocator that reports every allocation under Tag
+template <typename T, MemTag Tag>
+struct TrackingAllocator {
+    using value_type = T;
+    template <typename U> struct rebind { using other = TrackingAllocator<U, Tag>; };
+
+    TrackingAllocator() noexcept = default;
+    template <typename U> TrackingAllocator(const TrackingAllocator<U, Tag>&) noexcept {}
+
+    T* allocate(size_t n) {
+        T* ptr = std::allocator<T>().allocate(n);
+        MemTracker::on_alloc(Tag, n * sizeof(T));
+        return ptr;
+    }
+    void deallocate(T* ptr, size_t n) noexcept {
+        MemTracker::on_free(Tag, n * sizeof(T));
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U> bool operator==(const TrackingAllocator<U, Tag>&) const noexcept { return true; }
+    template <typename U> bool operator!=(const TrackingAllocator<U, Tag>&) const noexcept { return false; }
+};
+
+template <typename T, MemTag Tag>
+using tracked_vector = std::vector<T, TrackingAllocator<T, Tag>>;
+
+template <typename K, typename V, MemTag Tag>
+using tracked_unordered_map = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>,
+                                                 TrackingAllocator<std::pair<const K, V>, Tag>>;
+
+// Resident set size of this process, from /proc/self/status (0 when unavailable)
+struct RssSample {
+    size_t rss_kb = 0;  // VmRSS
+    size_t hwm_kb = 0;  // VmHWM, peak since process start or the last reset_rss_peak()
+};
+RssSample read_rss();
+// Reset VmHWM to the current RSS via /proc/self/clear_refs (Linux >= 4.0); false if refused
+bool reset_rss_peak();
+// ru_maxrss from getrusage, in kB (process lifetime)
+size_t max_rss_kb();
+
+// Hand the whole pages inside [p, p + bytes) back to the OS (madvise MADV_DONTNEED). The range
+// stays allocated and reads back as zeros. Returns the bytes released (0 where unsupported).
+size_t release_pages(void* p, size_t bytes);
+// Return free heap memory to the OS (glibc malloc_trim), so freed solver structures don't stay
+// resident in a long-lived process; no-op elsewhere
+void trim_heap();
+
+// One solve's memory: tracked bytes per structure, peak RSS per phase and for the process.
+struct MemReport {
+    bool enabled = false;
+    bool phase_rss_exact = false;  // VmHWM could be reset per phase; else RSS peaks are lifetime peaks
+    std::array<size_t, kPhaseCount> phase_rss_peak_kb{};
+    size_t rss_peak_kb = 0;        // peak RSS during the solve (lifetime ru_maxrss without resets)
+    std::array<MemTagStats, kMemTagCount> tags{};
+    size_t tracked_peak_bytes = 0; // peak of all tracked structures together
+    std::vector<size_t> round_rss_kb; // RSS after each trimming round
+
+    // Append the current RSS to round_rss_kb
+    void record_round();
+
+    // Reset tracker and RSS peaks before a solve / collect tag stats and the RSS peak after it
+    void begin();
+    void end();
+    // Peaks take the max, allocation counts add up
+    void merge(const MemReport& o);
+};
+
+// Records the RSS peak of one phase into report; a null report makes it a no-op.
+class MemScope {
+public:
+    MemScope(MemReport* report, Phase ph) : report_(report), ph_(ph) {
+        if (report_ && report_->phase_rss_exact) reset_rss_peak();
+    }
+    ~MemScope();
+    MemScope(const MemScope&) = delete;
+    MemScope& operator=(const MemScope&) = delete;
+
+private:
+    MemReport* report_;
+    Phase ph_;
+};
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_MEM_TRACK_H
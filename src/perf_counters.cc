@@ -0,0 +1,129 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include "util.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cuckoo_sip {
+
+const char* phase_name(Phase ph) {
+    switch (ph) {
+        case Phase::Seeding: return "seeding";
+        case Phase::Count: return "count";
+        case Phase::Filter: return "filter";
+        case Phase::Peel: return "peel";
+        case Phase::Recovery: return "recovery";
+    }
+    return "?";
+}
+
+void PerfReport::add(Phase ph, uint32_t thread, const PerfSample& s) {
+    const size_t i = static_cast<size_t>(ph);
+    PerfSample total = s;
+    if (thread > 0) total.wall_ns = 0; // overlaps the caller's
+    phases[i] += total;
+    if (threads.size() <= thread) threads.resize(thread + 1);
+    threads[thread][i] += s;
+}
+
+void PerfReport::merge(const PerfReport& o) {
+    enabled = enabled || o.enabled;
+    if (o.available) available = true;
+    if (error.empty()) error = o.error;
+    for (size_t i = 0; i < kPhaseCount; ++i) phases[i] += o.phases[i];
+    if (threads.size() < o.threads.size()) threads.resize(o.threads.size());
+    for (size_t t = 0; t < o.threads.size(); ++t)
+        for (size_t i = 0; i < kPhaseCount; ++i) threads[t][i] += o.threads[t][i];
+}
+
+#if defined(__linux__)
+
+static int open_event(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static constexpr uint64_t cache_miss(uint64_t cache) {
+    return cache | (static_cast<uint64_t>(PERF_COUNT_HW_CACHE_OP_READ) << 8) |
+           (static_cast<uint64_t>(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+}
+
+PerfCounters::PerfCounters() {
+    fds_.fill(-1);
+    const std::array<std::pair<uint32_t, uint64_t>, kEvents> events = {{
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL) },
+        { PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    }};
+    int first_errno = 0;
+    for (size_t i = 0; i < kEvents; ++i) {
+        fds_[i] = open_event(events[i].first, events[i].second);
+        if (fds_[i] >= 0) available_ = true;
+        else if (!first_errno) first_errno = errno;
+    }
+    if (!available_) error_ = std::string("perf_event_open failed: ") + std::strerror(first_errno);
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds_) if (fd >= 0) close(fd);
+}
+
+void PerfCounters::start() {
+    for (int fd : fds_) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    t0_ = now_ns();
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample s;
+    s.wall_ns = now_ns() - t0_;
+    uint64_t* dst[kEvents] = { &s.cycles, &s.instructions, &s.llc_misses, &s.dtlb_misses, &s.branch_misses };
+    for (size_t i = 0; i < kEvents; ++i) {
+        if (fds_[i] < 0) continue;
+        ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t v = 0;
+        if (read(fds_[i], &v, sizeof(v)) == static_cast<ssize_t>(sizeof(v))) *dst[i] = v;
+    }
+    return s;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    fds_.fill(-1);
+    error_ = "perf_event_open is Linux-only";
+}
+
+PerfCounters::~PerfCounters() {}
+
+void PerfCounters::start() { t0_ = now_ns(); }
+
+PerfSample PerfCounters::stop() {
+    PerfSample s;
+    s.wall_ns = now_ns() - t0_;
+    return s;
+}
+
+#endif
+
+} // namespace cuckoo_sip
@@ -0,0 +1,120 @@
+#ifndef CUCKOO_SIP_PERF_COUNTERS_H
+#define CUCKOO_SIP_PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cuckoo_sip {
+
+// Solver phases that get their own counter totals
+enum class Phase : uint32_t { Seeding = 0, Count = 1, Filter = 2, Peel = 3, Recovery = 4 };
+constexpr size_t kPhaseCount = 5;
+const char* phase_name(Phase ph);
+
+struct PerfSample {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t llc_misses = 0;
+    uint64_t dtlb_misses = 0;
+    uint64_t branch_misses = 0;
+    uint64_t wall_ns = 0;
+
+    PerfSample& operator+=(const PerfSample& o) {
+        cycles += o.cycles; instructions += o.instructions; llc_misses += o.llc_misses;
+        dtlb_misses += o.dtlb_misses; branch_misses += o.branch_misses; wall_ns += o.wall_ns;
+        return *this;
+    }
+};
+
+// Per-phase totals over all threads plus the per-thread breakdown: thread 0 is the solver's own
+// thread, 1.. the workers of a multi-threaded phase (PerfWorkers). Totals sum the counters of
+// every thread but keep thread 0's wall time. When counters can't be opened, available is
+// false, error says why, and only wall_ns is filled.
+struct PerfReport {
+    bool enabled = false;
+    bool available = false;
+    std::string error;
+    std::array<PerfSample, kPhaseCount> phases{};
+    std::vector<std::array<PerfSample, kPhaseCount>> threads;
+
+    void add(Phase ph, uint32_t thread, const PerfSample& s);
+    void merge(const PerfReport& o);
+};
+
+// Hardware counters (cycles, instructions, LLC misses, dTLB misses, branch misses) for the
+// calling thread via Linux perf_event_open. Events the kernel refuses are left at zero; if none
+// open, available() is false. User-space only, so perf_event_paranoid <= 2 suffices.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return available_; }
+    const std::string& error() const { return error_; }
+
+    void start();
+    PerfSample stop(); // deltas since start()
+
+private:
+    static constexpr size_t kEvents = 5;
+    std::array<int, kEvents> fds_;
+    bool available_ = false;
+    std::string error_;
+    uint64_t t0_ = 0;
+};
+
+// Counts one phase on the current thread into report; a null report or counters makes it a no-op.
+class PerfScope {
+public:
+    PerfScope(PerfReport* report, PerfCounters* counters, Phase ph, uint32_t thread = 0)
+        : report_(report), counters_(counters), ph_(ph), thread_(thread) {
+        if (report_ && counters_) counters_->start();
+    }
+    ~PerfScope() {
+        if (report_ && counters_) report_->add(ph_, thread_, counters_->stop());
+    }
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfReport* report_;
+    PerfCounters* counters_;
+    Phase ph_;
+    uint32_t thread_;
+};
+
+// Counters for the workers of one phase. Worker t wraps its share in run(t, f) on its own thread
+// (each run opens counters for that thread; repeated runs accumulate); record() adds worker t as
+// thread t + 1 once they have joined. A null report makes both no-ops.
+class PerfWorkers {
+public:
+    PerfWorkers(PerfReport* report, Phase ph, uint32_t workers)
+        : report_(report), ph_(ph), samples_(report ? workers : 0) {}
+
+    template <class F>
+    void run(uint32_t t, F&& f) {
+        if (!report_) { f(); return; }
+        PerfCounters c;
+        c.start();
+        f();
+        samples_[t] += c.stop();
+    }
+
+    void record() const {
+        for (size_t t = 0; t < samples_.size(); ++t) report_->add(ph_, static_cast<uint32_t>(t + 1), samples_[t]);
+    }
+
+private:
+    PerfReport* report_;
+    Phase ph_;
+    std::vector<PerfSample> samples_;
+};
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_PERF_COUNTERS_H
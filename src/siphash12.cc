@@ -56,4 +56,67 @@ void siphash24_batch(const SipHashKey& key, const uint64_t* nonces, uint64_t* ou
     for (size_t i = 0; i < count; ++i) out[i] = siphash24(key, nonces[i]);
 }
 
+template <int C, int D>
+static inline void siphash_block_core(const SipHashKey& key, uint64_t nonce0, uint64_t* out) {
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key.k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key.k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key.k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ key.k1;
+    for (size_t i = 0; i < kSipBlock; ++i) {
+        const uint64_t m = nonce0 + i;
+        v3 ^= m;
+        for (int r = 0; r < C; ++r) SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+        v2 ^= 0xff;
+        for (int r = 0; r < D; ++r) SIPROUND(v0, v1, v2, v3);
+        out[i] = v0 ^ v1 ^ v2 ^ v3;
+    }
+    const uint64_t last = out[kSipBlock - 1];
+    for (size_t i = 0; i + 1 < kSipBlock; ++i) out[i] ^= last;
+}
+
+void siphash12_block(const SipHashKey& key, uint64_t nonce0, uint64_t* out) {
+    siphash_block_core<1, 2>(key, nonce0, out);
+}
+
+void siphash24_block(const SipHashKey& key, uint64_t nonce0, uint64_t* out) {
+    siphash_block_core<2, 4>(key, nonce0, out);
+}
+
+// Lane-parallel SipHash: every step is applied to kSipLanes independent states so the
+// compiler can keep them in vector registers.
+template <int C, int D>
+static inline void siphash_multikey_core(const uint64_t* k0, const uint64_t* k1, uint64_t m, uint64_t* out, size_t count) {
+    constexpr size_t L = kSipLanes;
+    size_t g = 0;
+    for (; g + L <= count; g += L) {
+        uint64_t v0[L], v1[L], v2[L], v3[L];
+        for (size_t l = 0; l < L; ++l) {
+            v0[l] = 0x736f6d6570736575ULL ^ k0[g + l];
+            v1[l] = 0x646f72616e646f6dULL ^ k1[g + l];
+            v2[l] = 0x6c7967656e657261ULL ^ k0[g + l];
+            v3[l] = 0x7465646279746573ULL ^ k1[g + l] ^ m;
+        }
+        for (int r = 0; r < C; ++r)
+            for (size_t l = 0; l < L; ++l) SIPROUND(v0[l], v1[l], v2[l], v3[l]);
+        const uint64_t b = (uint64_t)8 << 56;
+        for (size_t l = 0; l < L; ++l) { v0[l] ^= m; v3[l] ^= b; }
+        for (int r = 0; r < C; ++r)
+            for (size_t l = 0; l < L; ++l) SIPROUND(v0[l], v1[l], v2[l], v3[l]);
+        for (size_t l = 0; l < L; ++l) { v0[l] ^= b; v2[l] ^= 0xff; }
+        for (int r = 0; r < D; ++r)
+            for (size_t l = 0; l < L; ++l) SIPROUND(v0[l], v1[l], v2[l], v3[l]);
+        for (size_t l = 0; l < L; ++l) out[g + l] = v0[l] ^ v1[l] ^ v2[l] ^ v3[l];
+    }
+    for (; g < count; ++g) out[g] = siphash_core(SipHashKey{ k0[g], k1[g] }, m, C, D);
+}
+
+void siphash12_multikey(const uint64_t* k0, const uint64_t* k1, uint64_t nonce, uint64_t* out, size_t count) {
+    siphash_multikey_core<1, 2>(k0, k1, nonce, out, count);
+}
+
+void siphash24_multikey(const uint64_t* k0, const uint64_t* k1, uint64_t nonce, uint64_t* out, size_t count) {
+    siphash_multikey_core<2, 4>(k0, k1, nonce, out, count);
+}
+
 } // namespace cuckoo_sip
@@ -24,6 +24,18 @@ uint64_t siphash24(const SipHashKey& key, uint64_t nonce);
 void siphash12_batch(const SipHashKey& key, const uint64_t* nonces, uint64_t* out, size_t count);
 void siphash24_batch(const SipHashKey& key, const uint64_t* nonces, uint64_t* out, size_t count);
 
+// Multi-key PRF: one nonce hashed under count keys (k0[g], k1[g]), computed lane-parallel across keys
+constexpr size_t kSipLanes = 4;
+void siphash12_multikey(const uint64_t* k0, const uint64_t* k1, uint64_t nonce, uint64_t* out, size_t count);
+void siphash24_multikey(const uint64_t* k0, const uint64_t* k1, uint64_t nonce, uint64_t* out, size_t count);
+
+// Block PRF (Cuckaroo-style): one state advanced over kSipBlock consecutive nonces nonce0.., each
+// step absorbing its nonce with the variant's compression and finalization rounds; every output
+// is then XORed with the last one, so no output is known before the whole block is hashed.
+constexpr size_t kSipBlock = 64;
+void siphash12_block(const SipHashKey& key, uint64_t nonce0, uint64_t* out);
+void siphash24_block(const SipHashKey& key, uint64_t nonce0, uint64_t* out);
+
 // Convenience: dispatch by variant
 inline uint64_t siphash_dispatch(SipHashVariant v, const SipHashKey& key, uint64_t nonce) {
     return (v == SipHashVariant::SipHash12) ? siphash12(key, nonce) : siphash24(key, nonce);
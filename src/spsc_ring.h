@@ -0,0 +1,84 @@
+#ifndef CUCKOO_SIP_SPSC_RING_H
+#define CUCKOO_SIP_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <thread>
+
+namespace cuckoo_sip {
+
+// Bounded lock-free single-producer/single-consumer ring. Slots are filled and drained in place
+// (claim/publish, front/pop) so large batch types are never copied. head_ and tail_ live on
+// separate cache lines, and each side caches the other's index to avoid reloading it per slot.
+template <typename T, typename Alloc = std::allocator<T>>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity = 16) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        slots_.resize(cap);
+        mask_ = cap - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: free slot to fill, or nullptr when full
+    T* claim() {
+        const size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (t - head_cache_ > mask_) return nullptr;
+        }
+        return &slots_[t & mask_];
+    }
+    // Producer: make the claimed slot visible to the consumer
+    void publish() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Producer: blocking claim (yields while the consumer catches up)
+    T* claim_wait() {
+        T* slot;
+        while (!(slot = claim())) std::this_thread::yield();
+        return slot;
+    }
+    // Producer: no more slots will be published
+    void close() { closed_.store(true, std::memory_order_release); }
+
+    // Consumer: oldest published slot, or nullptr when empty
+    T* front() {
+        const size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (h == tail_cache_) return nullptr;
+        }
+        return &slots_[h & mask_];
+    }
+    // Consumer: release the slot returned by front()
+    void pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer: closed and fully drained
+    bool finished() {
+        if (!closed_.load(std::memory_order_acquire)) return false;
+        return front() == nullptr;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+    size_t memory_bytes() const { return slots_.capacity() * sizeof(T); }
+
+private:
+    std::vector<T, Alloc> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{ 0 }; // consumer index
+    size_t tail_cache_ = 0;                      // consumer's view of tail_
+    alignas(64) std::atomic<size_t> tail_{ 0 }; // producer index
+    size_t head_cache_ = 0;                      // producer's view of head_
+    alignas(64) std::atomic<bool> closed_{ false };
+};
+
+} // namespace cuckoo_sip
+
+#endif // CUCKOO_SIP_SPSC_RING_H
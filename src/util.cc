@@ -51,6 +51,10 @@ std::optional<SipHashKey> parse_hex_key128(const std::string& hex) {
 std::string random_hex_header() {
     std::random_device rd;
     std::mt19937_64 gen(rd());
+    return seeded_hex_header(gen);
+}
+
+std::string seeded_hex_header(std::mt19937_64& gen) {
     std::uniform_int_distribution<uint64_t> dist;
     uint64_t a = dist(gen), b = dist(gen);
     std::ostringstream oss;
@@ -58,4 +62,12 @@ std::string random_hex_header() {
     return oss.str();
 }
 
+std::vector<std::string> split_list(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::string cur;
+    std::istringstream iss(s);
+    while (std::getline(iss, cur, sep)) if (!cur.empty()) out.push_back(cur);
+    return out;
+}
+
 } // namespace cuckoo_sip
@@ -23,6 +23,12 @@ std::optional<SipHashKey> parse_hex_key128(const std::string& hex);
 // Produce random header bytes as hex string (32 hex chars)
 std::string random_hex_header();
 
+// Same format as random_hex_header, drawn from a caller-seeded generator (reproducible runs)
+std::string seeded_hex_header(std::mt19937_64& gen);
+
+// Split "a,b,c" into its non-empty fields
+std::vector<std::string> split_list(const std::string& s, char sep = ',');
+
 // Timing helper
 inline uint64_t now_ns() {
     return std::chrono::duration_cast<std::chrono::nanoseconds>(
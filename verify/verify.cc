@@ -66,7 +66,9 @@ bool verify_cycle_k(const Params& p, const std::vector<uint64_t>& edges, size_t
         }
     }
 
-    if (!(cur_u == us[0] && cur_v == vs[0])) {
+    // The walk leaves edge 0 through its v node and, for even k, ends on a u node; the cycle
+    // closes when that is edge 0's u node.
+    if ((k & 1) || cur_u != us[0]) {
         if (err) *err = "Cycle does not return to starting node";
         return false;
     }